@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "Annotate.h"
+#include "Pgn.h"
+#include "ThreadPool.h"
+
+namespace Annotate {
+	namespace {
+		// only what the search needs, the tags aren't kept
+		// a game takes far longer to search than to hold, so the whole file is read before the first search
+		struct GameMoves {
+			std::string startFen;
+			std::vector<Move> moves;
+		};
+
+		struct Worker : SearchWorker {
+			using SearchWorker::SearchWorker;
+
+			// over all the games of the worker
+			uint64_t positions = 0;
+			uint64_t nodes = 0;
+		};
+
+		// the json lines of the positions of the game
+		std::string AnnotateGame(Worker& worker, size_t index, const GameMoves& game, const Options& options) {
+			std::stringstream ss;
+			ss << std::fixed << std::setprecision(2);
+			// the table and the move ordering history are kept, only the game is replaced
+			worker.engine.SetPosition(game.startFen);
+			for (size_t ply = 0; ply < game.moves.size(); ply++) {
+				const Move& played = game.moves[ply];
+				if (not worker.chess.IsGameOver()) {
+					if (options.moveTimeMs > 0) {
+						worker.engine.SetThinkTime(options.moveTimeMs);
+						worker.engine.ApplyThinkingPolicy();
+					}
+					else
+						worker.engine.SetDepth(options.depth);
+					MoveReturnData data = worker.engine.GetBestMove();
+					const SearchStats& stats = worker.engine.GetLastStats();
+					const AnalysisLine& line = worker.engine.GetLines().front();
+					worker.positions++;
+					worker.nodes += stats.nodes;
+
+					ss << "{\"game\":" << index << ",\"ply\":" << ply << ",\"move\":\"" << Move2Chess(played) << "\",\"best\":\"" <<
+					Move2Chess(data.move) << "\",\"score\":" << line.score << ",\"mate\":";
+					if (line.mate_in)
+						ss << line.mate_in.value();
+					else
+						ss << "null";
+					ss << ",\"depth\":" << stats.depth << ",\"nodes\":" << stats.nodes << "}\n";
+				}
+				worker.engine.ApplyMove(played);
+			}
+			return ss.str();
+		}
+	}
+
+	Stats Run(const std::string& pgnPath, std::ostream& out, const Options& options) {
+		Stats stats;
+		size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+		// the games are read on the pool, then the engines share it for the bitbases, they search on the threads of the workers
+		ThreadPool pool(threads);
+		std::vector<GameMoves> games;
+		{
+			std::vector<std::vector<GameMoves>> chunks(threads * 4);
+			Pgn::ReadStats readStats = Pgn::ReadFile(pgnPath, chunks.size(), [&chunks](const Pgn::Game& game, size_t chunk) {
+				chunks[chunk].push_back({game.startFen, game.moves});
+			}, &pool);
+			stats.errors = readStats.errors;
+			stats.readMs = readStats.timeMs;
+			for (std::vector<GameMoves>& chunk : chunks)
+				std::ranges::move(chunk, std::back_inserter(games));
+		}
+		stats.games = games.size();
+
+		auto start = std::chrono::steady_clock::now();
+		// built one after the other, the first one builds the bitbases for all of them
+		std::vector<std::unique_ptr<Worker>> workers;
+		for (size_t i = 0; i < threads; i++)
+			workers.push_back(std::make_unique<Worker>(options.hashMegabytes, pool));
+
+		// a worker takes the next game whenever it is done with one, the games differ a lot in length
+		std::atomic<size_t> next = 0;
+		std::mutex outMutex;
+		std::vector<std::string> results(games.size());
+		std::vector<bool> done(games.size());
+		size_t written = 0;
+		{
+			std::vector<std::jthread> workerThreads;
+			for (const auto& worker : workers)
+				workerThreads.emplace_back([&, &worker = *worker] {
+					for (size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < games.size();) {
+						std::string lines = AnnotateGame(worker, index, games[index], options);
+						std::lock_guard lock(outMutex);
+						results[index] = std::move(lines);
+						done[index] = true;
+						// the games are written in the order of the file, each as soon as the ones before it are
+						for (; written < games.size() and done[written]; written++) {
+							out << results[written];
+							results[written] = {};
+						}
+					}
+				});
+		}
+		out.flush();
+		if (not out)
+			throw std::runtime_error("could not write the annotations");
+
+		for (const auto& worker : workers) {
+			stats.positions += worker->positions;
+			stats.nodes += worker->nodes;
+		}
+		stats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+}
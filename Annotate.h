@@ -0,0 +1,34 @@
+#pragma once
+#include "Engine.h"
+
+// every position of every game of a pgn file searched, for the evaluation and the best move of each
+namespace Annotate {
+	struct Options {
+		int depth = 8;
+		// every position is searched until then instead of to the depth
+		int moveTimeMs = 0;
+		// the table of each worker, it is kept from one position and game to the next
+		size_t hashMegabytes = 16;
+		// one worker per core if 0
+		size_t threads = 0;
+	};
+
+	struct Stats {
+		uint64_t games = 0;
+		// games with a move that isn't legal or can't be read, they are skipped
+		uint64_t errors = 0;
+		uint64_t positions = 0;
+		uint64_t nodes = 0;
+		double readMs = 0;
+		double timeMs = 0;
+	};
+
+	// a json line per position to out, in the order of the file:
+	//   {"game":0,"ply":0,"move":"e2e4","best":"d2d4","score":0.31,"mate":null,"depth":8,"nodes":5231}
+	// move is the one played, score is in pawns for the side to move, mate in moves positive when white mates
+	// the positions where the game is already over, by repetition or the fifty move rule, are left out
+	// each game is searched position after position by one worker, so the entries of a position help the next one,
+	// and the workers share nothing but the output, so it scales with the cores
+	// throws std::runtime_error if the file can't be read or the output can't be written
+	Stats Run(const std::string& pgnPath, std::ostream& out, const Options& options = {});
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// precomputed attack tables for the mailbox board
+// squares are indexed like the RawBoard: a8 = 0, h8 = 7, ..., a1 = 56, h1 = 63
+namespace AttackTables {
+	// the squares a knight, king or pawn can reach from a square
+	struct Leaper {
+		uint8_t count = 0;
+		std::array<uint8_t, 8> squares{};
+	};
+
+	// the squares in one direction from a square, closest first
+	struct Ray {
+		uint8_t length = 0;
+		std::array<uint8_t, 7> squares{};
+	};
+
+	// the first four directions are orthogonal (rook), the last four diagonal (bishop)
+	constexpr int DIRECTION_COUNT = 8;
+	constexpr std::array<std::pair<int, int>, DIRECTION_COUNT> DIRECTIONS = {{
+		{0, 1}, {1, 0}, {0, -1}, {-1, 0},
+		{1, 1}, {1, -1}, {-1, -1}, {-1, 1}
+	}};
+
+	constexpr int Index(int col, int row) { return col + 8 * (7 - row); }
+	constexpr int Col(int index) { return index % 8; }
+	constexpr int Row(int index) { return 7 - index / 8; }
+	constexpr bool InBounds(int col, int row) { return 0 <= col and col < 8 and 0 <= row and row < 8; }
+
+	// the direction going the other way, orthogonal ones stay orthogonal
+	constexpr int Opposite(int direction) { return (direction & 4) | ((direction + 2) & 3); }
+
+	template<size_t N>
+	consteval std::array<Leaper, 64> GenerateLeaper(const std::array<std::pair<int, int>, N>& offsets) {
+		std::array<Leaper, 64> table{};
+		for (int index = 0; index < 64; index++) {
+			for (auto [dx, dy] : offsets) {
+				int col = Col(index) + dx;
+				int row = Row(index) + dy;
+				if (InBounds(col, row))
+					table[index].squares[table[index].count++] = (uint8_t)Index(col, row);
+			}
+		}
+		return table;
+	}
+
+	consteval std::array<std::array<Ray, DIRECTION_COUNT>, 64> GenerateRays() {
+		std::array<std::array<Ray, DIRECTION_COUNT>, 64> table{};
+		for (int index = 0; index < 64; index++) {
+			for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+				auto [dx, dy] = DIRECTIONS[direction];
+				Ray& ray = table[index][direction];
+				for (int col = Col(index) + dx, row = Row(index) + dy; InBounds(col, row); col += dx, row += dy)
+					ray.squares[ray.length++] = (uint8_t)Index(col, row);
+			}
+		}
+		return table;
+	}
+
+	inline constexpr std::array<Leaper, 64> KNIGHT = GenerateLeaper(std::array<std::pair<int, int>, 8>{{
+		{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}
+	}});
+
+	inline constexpr std::array<Leaper, 64> KING = GenerateLeaper(std::array<std::pair<int, int>, 8>{{
+		{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}
+	}});
+
+	// the squares a pawn of a color has to stand on to attack a square, indexed by [Player][square]
+	// white pawns attack upwards so they attack from the row below, and the opposite for black
+	inline constexpr std::array<std::array<Leaper, 64>, 2> PAWN_ATTACKERS = {
+		GenerateLeaper(std::array<std::pair<int, int>, 2>{{{-1, -1}, {1, -1}}}),
+		GenerateLeaper(std::array<std::pair<int, int>, 2>{{{-1, 1}, {1, 1}}})
+	};
+
+	inline constexpr std::array<std::array<Ray, DIRECTION_COUNT>, 64> RAYS = GenerateRays();
+
+	// the squares strictly between two squares as a mask of RawBoard indices, 0 if they are not on a line
+	consteval std::array<std::array<uint64_t, 64>, 64> GenerateBetween() {
+		std::array<std::array<uint64_t, 64>, 64> table{};
+		for (int from = 0; from < 64; from++)
+			for (const Ray& ray : RAYS[from]) {
+				uint64_t between = 0;
+				for (int i = 0; i < ray.length; i++) {
+					table[from][ray.squares[i]] = between;
+					between |= 1ULL << ray.squares[i];
+				}
+			}
+		return table;
+	}
+
+	// the whole line through two squares, from edge to edge, 0 if they are not on one
+	consteval std::array<std::array<uint64_t, 64>, 64> GenerateLine() {
+		std::array<std::array<uint64_t, 64>, 64> table{};
+		for (int from = 0; from < 64; from++)
+			for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+				uint64_t line = 1ULL << from;
+				for (int side : {direction, Opposite(direction)}) {
+					const Ray& ray = RAYS[from][side];
+					for (int i = 0; i < ray.length; i++)
+						line |= 1ULL << ray.squares[i];
+				}
+				const Ray& ray = RAYS[from][direction];
+				for (int i = 0; i < ray.length; i++)
+					table[from][ray.squares[i]] = line;
+			}
+		return table;
+	}
+
+	// the direction of the ray from one square that goes through the other, -1 if there is none
+	consteval std::array<std::array<int8_t, 64>, 64> GenerateDirections() {
+		std::array<std::array<int8_t, 64>, 64> table{};
+		for (auto& row : table)
+			row.fill(-1);
+		for (int from = 0; from < 64; from++)
+			for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+				const Ray& ray = RAYS[from][direction];
+				for (int i = 0; i < ray.length; i++)
+					table[from][ray.squares[i]] = (int8_t)direction;
+			}
+		return table;
+	}
+
+	inline constexpr std::array<std::array<uint64_t, 64>, 64> BETWEEN = GenerateBetween();
+	inline constexpr std::array<std::array<uint64_t, 64>, 64> LINE = GenerateLine();
+	inline constexpr std::array<std::array<int8_t, 64>, 64> DIRECTION = GenerateDirections();
+}
@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "Bitbases.h"
+
+namespace Benchmark {
+	static const std::array<std::string, 4> s_Positions = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	};
+
+	void Run(int depth, const std::string& statsTarget, const SearchOptions& options, int moveTimeMs, size_t hashMegabytes,
+			 const std::string& hashFile, bool sharedHash, bool think) {
+		StatsWriter statsWriter;
+		if (not statsTarget.empty() and not statsWriter.Open(statsTarget))
+			std::cout << "Could not open " << statsTarget << " for the search stats" << std::endl;
+
+		// the endgame tables are built once for the process, not by the first search
+		{
+			ThreadPool pool;
+			Bitbases::Init(&pool);
+			const Bitbases::BuildStats& bitbases = Bitbases::GetBuildStats();
+			std::cout << std::fixed << std::setprecision(2) << "Bitbases " << (bitbases.fromCache ? "loaded" : "built") <<
+			" in " << bitbases.timeMs << "[ms]" << std::endl;
+		}
+
+		PerfCounters::ResetRun();
+		auto start = std::chrono::steady_clock::now();
+		uint64_t nodes = 0;
+
+		for (const std::string& fen : s_Positions) {
+			std::cout << "\n" << fen << std::endl;
+			Chess chess(fen);
+			// one engine at a time, so its threads have all the cores for thinking and for clearing or loading the table
+			Engine engine(chess, std::max(1u, std::thread::hardware_concurrency()));
+			engine.SetDepth(depth);
+			engine.SetStatsWriter(&statsWriter);
+			engine.GetSearchOptions() = options;
+			if (hashMegabytes > 0) {
+				auto allocStart = std::chrono::steady_clock::now();
+				engine.SetHashSize(hashMegabytes);
+				auto clearStart = std::chrono::steady_clock::now();
+				engine.ClearHash();
+				auto clearEnd = std::chrono::steady_clock::now();
+				const TranspositionTable& tt = engine.GetTranspositionTable();
+				std::cout << std::fixed << std::setprecision(2) << "Hash: " << tt.GetSize() / (1024 * 1024) << " MB on " << Memory::PagesName(tt.GetPages()) <<
+				", allocated in " << std::chrono::duration<double, std::milli>(clearStart - allocStart).count() <<
+				"[ms], cleared in " << std::chrono::duration<double, std::milli>(clearEnd - clearStart).count() << "[ms]" << std::endl;
+			}
+			if (not hashFile.empty()) {
+				auto loadStart = std::chrono::steady_clock::now();
+				bool loaded = engine.LoadHash(hashFile, sharedHash);
+				std::cout << std::fixed << std::setprecision(2) << "Hash file: " << (loaded ? (sharedHash ? "shared" : "loaded") : "cold") <<
+				" in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count() << "[ms]" << std::endl;
+			}
+			if (moveTimeMs > 0 and not think) {
+				engine.SetThinkTime(moveTimeMs);
+				engine.ApplyThinkingPolicy();
+			}
+			auto moveStart = std::chrono::steady_clock::now();
+			Move move;
+			if (think) {
+				// the calling thread only waits, the stats of the thinking come with StopThinking
+				engine.Think();
+				std::this_thread::sleep_for(std::chrono::milliseconds(moveTimeMs));
+				engine.StopThinking();
+				move = engine.GetLastStats().bestMove;
+			}
+			else
+				move = engine.GetBestMove().move;
+			auto moveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - moveStart).count();
+			nodes += engine.GetLastStats().nodes;
+			std::cout << "Best move: " << move << " in " << moveMs << "[ms]" << std::endl;
+			// a shared table is already in the file
+			if (not hashFile.empty() and not sharedHash)
+				engine.SaveHash(hashFile);
+		}
+
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+		std::cout << "\nBenchmark: " << s_Positions.size() << " positions ";
+		if (think)
+			std::cout << "thought about for " << moveTimeMs << "[ms] each";
+		else
+			std::cout << "at depth " << depth;
+		std::cout << " in " << ms.count() << "[ms], " << nodes << " nodes" << std::endl;
+
+		if (PerfCounters::IsEnabled())
+			PerfCounters::PrintSummary(std::cout, PerfCounters::GetRunSummary());
+		if (Timer::IsEnabled())
+			Timer::PrintDurations();
+	}
+
+	template<typename Function>
+	static void Measure(const std::string& name, int iterations, Function function) {
+		auto start = std::chrono::steady_clock::now();
+		size_t checksum = 0;
+		for (int i = 0; i < iterations; i++)
+			checksum += function(i);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2) <<
+		std::setw(10) << iterations / seconds / 1e6 << " M/s" << "  (checksum " << checksum << ")" << std::endl;
+	}
+
+	void RunPositionFormats(int iterations) {
+		std::vector<Board> boards;
+		std::vector<PackedPosition> packed;
+		for (const std::string& fen : s_Positions) {
+			boards.emplace_back(fen);
+			packed.push_back(boards.back().Pack());
+		}
+		const size_t count = s_Positions.size();
+
+		Measure("fen parse", iterations, [&](int i) {
+			return (size_t)Board(s_Positions[i % count]).GetFullMoves();
+		});
+		Measure("fen write", iterations, [&](int i) {
+			char buffer[Board::MAX_FEN_LENGTH];
+			return boards[i % count].WriteFen(buffer);
+		});
+		Measure("GetFen", iterations, [&](int i) {
+			return boards[i % count].GetFen().size();
+		});
+		Measure("pack", iterations, [&](int i) {
+			return (size_t)boards[i % count].Pack().occupancy;
+		});
+		Measure("unpack", iterations, [&](int i) {
+			return (size_t)Board(packed[i % count]).GetFullMoves();
+		});
+	}
+
+	// throughput of the material and piece-square scoring, the kernels have to agree on every position
+	void RunEvaluation(int iterations) {
+		std::vector<Board> boards;
+		for (const std::string& fen : s_Positions)
+			boards.emplace_back(fen);
+		size_t count = boards.size();
+
+		for (const Board& board : boards) {
+			int scalar = StaticEvaluator::ScoreRawBoardScalar(board.GetRawBoard());
+			int vectorized = StaticEvaluator::ScoreRawBoard(board.GetRawBoard());
+			if (scalar != vectorized)
+				throw std::runtime_error("evaluation kernels disagree on " + board.GetFen());
+			std::cout << board.GetFen() << ": " << scalar << " cp" << std::endl;
+		}
+
+		// what the evaluation did before, a switch per square and material only
+		Measure("switch", iterations, [&](int i) {
+			const Board& board = boards[i % count];
+			Score score = 0;
+			for (int square = 0; square < 64; square++) {
+				char piece = board[square];
+				score += piece >= 'a' ? -StaticEvaluator::PieceValue(piece) : StaticEvaluator::PieceValue(piece);
+			}
+			return (size_t)(int)score;
+		});
+		Measure("scalar", iterations, [&](int i) {
+			return (size_t)StaticEvaluator::ScoreRawBoardScalar(boards[i % count].GetRawBoard());
+		});
+#ifdef __AVX2__
+		Measure("avx2", iterations, [&](int i) {
+			return (size_t)StaticEvaluator::ScoreRawBoardAvx2(boards[i % count].GetRawBoard());
+		});
+#endif
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "Engine.h"
+
+namespace Benchmark {
+	// searches a fixed set of positions and reports the time and the hardware counters per move and for the run
+	// the stats of each search are also written as json lines to the target if there is one
+	// with a move time, every search deepens until its deadline instead of stopping at the depth
+	// with a hash size, every engine gets a table that big, the time to allocate and clear it is reported
+	// with a hash file, every engine starts from the table in it, and saves its own there unless the file is shared
+	// thinking, every position is searched in the background on the pool of the engine for the move time instead
+	void Run(int depth, const std::string& statsTarget = "", const SearchOptions& options = {}, int moveTimeMs = 0,
+			 size_t hashMegabytes = 0, const std::string& hashFile = "", bool sharedHash = false, bool think = false);
+
+	// throughput of the position formats: fen parsing and writing, packing and unpacking
+	void RunPositionFormats(int iterations);
+
+	// throughput of the material and piece-square scoring, scalar against the vectorized kernel
+	void RunEvaluation(int iterations);
+}
@@ -0,0 +1,288 @@
+#include "pch.h"
+#include "Bitbases.h"
+#include "ThreadPool.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace Bitbases {
+	namespace {
+		// the tables, the ones a pawn promotes into are built first
+		enum Table : uint8_t {
+			KQK, KRK, KPK, TABLE_COUNT
+		};
+
+		// the board is seen from the side with the piece, flipped vertically when it is black's
+		// index bits: 18 the weak side to move, 12-17 the strong king, 6-11 the weak king, 0-5 the piece
+		constexpr size_t POSITIONS = 1 << 19;
+		constexpr size_t WORDS = POSITIONS / 64;
+		constexpr uint32_t CACHE_VERSION = 1;
+		constexpr char CACHE_MAGIC[8] = {'B', 'I', 'T', 'B', 'A', 'S', 'E', 'S'};
+
+		// the bits are only ever set, so the threads building a table can read and set them in any order
+		std::array<std::array<std::atomic<uint64_t>, WORDS>, TABLE_COUNT> s_Tables{};
+		std::once_flag s_InitFlag;
+		std::atomic_bool s_Ready = false;
+		std::string s_CachePath;
+		BuildStats s_Stats;
+
+		constexpr int Index(bool strongToMove, int strongKing, int weakKing, int piece) {
+			return (strongToMove ? 0 : 1 << 18) | strongKing << 12 | weakKing << 6 | piece;
+		}
+
+		bool IsWin(Table table, int index) {
+			return s_Tables[table][index >> 6].load(std::memory_order_relaxed) >> (index & 63) & 1;
+		}
+
+		bool IsAdjacent(int lhs, int rhs) {
+			using namespace AttackTables;
+			return std::abs(Col(lhs) - Col(rhs)) <= 1 and std::abs(Row(lhs) - Row(rhs)) <= 1;
+		}
+
+		// does the strong side attack the square, the weak king is taken off the board so it can't shield the squares behind it
+		bool IsAttacked(Table table, int square, int strongKing, int piece) {
+			if (IsAdjacent(square, strongKing))
+				return true;
+			if (square == piece)
+				return false;
+			if (table == KPK) {
+				const AttackTables::Leaper& pawns = AttackTables::PAWN_ATTACKERS[static_cast<int>(Player::White)][square];
+				return std::find(pawns.squares.begin(), pawns.squares.begin() + pawns.count, piece) != pawns.squares.begin() + pawns.count;
+			}
+			int direction = AttackTables::DIRECTION[piece][square];
+			return direction >= 0 and (table == KQK or direction < 4) and
+				   not (AttackTables::BETWEEN[piece][square] >> strongKing & 1);
+		}
+
+		bool IsValid(Table table, bool strongToMove, int strongKing, int weakKing, int piece) {
+			if (strongKing == weakKing or strongKing == piece or weakKing == piece or IsAdjacent(strongKing, weakKing))
+				return false;
+			int row = AttackTables::Row(piece);
+			if (table == KPK and (row == 0 or row == 7))
+				return false;
+			// the side that just moved can't have left its king in check
+			return not strongToMove or not IsAttacked(table, weakKing, strongKing, piece);
+		}
+
+		// the strong side wins if one of its moves wins
+		bool StrongWins(Table table, int strongKing, int weakKing, int piece) {
+			const AttackTables::Leaper& kings = AttackTables::KING[strongKing];
+			for (int i = 0; i < kings.count; i++) {
+				int to = kings.squares[i];
+				if (to != piece and not IsAdjacent(to, weakKing) and IsWin(table, Index(false, to, weakKing, piece)))
+					return true;
+			}
+
+			if (table == KPK) {
+				auto free = [&](int square) { return square != strongKing and square != weakKing; };
+				int to = piece - 8;
+				if (not free(to))
+					return false;
+				// it becomes a queen, or a rook where the queen would stalemate
+				if (AttackTables::Row(to) == 7)
+					return IsWin(KQK, Index(false, strongKing, weakKing, to)) or IsWin(KRK, Index(false, strongKing, weakKing, to));
+				if (IsWin(KPK, Index(false, strongKing, weakKing, to)))
+					return true;
+				return AttackTables::Row(piece) == 1 and free(to - 8) and IsWin(KPK, Index(false, strongKing, weakKing, to - 8));
+			}
+
+			for (int direction = 0; direction < (table == KQK ? AttackTables::DIRECTION_COUNT : 4); direction++) {
+				const AttackTables::Ray& ray = AttackTables::RAYS[piece][direction];
+				for (int i = 0; i < ray.length; i++) {
+					int to = ray.squares[i];
+					if (to == strongKing or to == weakKing)
+						break;
+					if (IsWin(table, Index(false, strongKing, weakKing, to)))
+						return true;
+				}
+			}
+			return false;
+		}
+
+		// the weak side loses if it is mated, or if every move loses
+		bool WeakLoses(Table table, int strongKing, int weakKing, int piece) {
+			bool canMove = false;
+			const AttackTables::Leaper& kings = AttackTables::KING[weakKing];
+			for (int i = 0; i < kings.count; i++) {
+				int to = kings.squares[i];
+				if (IsAttacked(table, to, strongKing, piece))
+					continue;
+				// taking the piece leaves two bare kings
+				if (to == piece)
+					return false;
+				canMove = true;
+				if (not IsWin(table, Index(true, strongKing, to, piece)))
+					return false;
+			}
+			return canMove or IsAttacked(table, weakKing, strongKing, piece);
+		}
+
+		// sets the bits of the positions in the words that are won now, returns if it found any
+		bool BuildWords(Table table, size_t begin, size_t end) {
+			bool changed = false;
+			for (size_t word = begin; word < end; word++) {
+				uint64_t known = s_Tables[table][word].load(std::memory_order_relaxed);
+				uint64_t won = 0;
+				for (int bit = 0; bit < 64; bit++) {
+					if (known >> bit & 1)
+						continue;
+					int index = (int)(word * 64) + bit;
+					bool strongToMove = not (index >> 18 & 1);
+					int strongKing = index >> 12 & 63;
+					int weakKing = index >> 6 & 63;
+					int piece = index & 63;
+					if (not IsValid(table, strongToMove, strongKing, weakKing, piece))
+						continue;
+					if (strongToMove ? StrongWins(table, strongKing, weakKing, piece) : WeakLoses(table, strongKing, weakKing, piece))
+						won |= 1ULL << bit;
+				}
+				if (won) {
+					s_Tables[table][word].fetch_or(won, std::memory_order_relaxed);
+					changed = true;
+				}
+			}
+			return changed;
+		}
+
+		// every pass finds the positions won one move further from the mate, until a pass finds none
+		void Build(ThreadPool* pool) {
+			for (Table table : {KQK, KRK, KPK}) {
+				while (true) {
+					s_Stats.passes++;
+					std::atomic_bool changed = false;
+					if (pool) {
+						ThreadPool::Batch batch(*pool);
+						size_t slices = pool->GetThreadCount() * 4;
+						for (size_t slice = 0; slice < slices; slice++)
+							batch.Submit([&changed, table, slice, slices] {
+								if (BuildWords(table, WORDS * slice / slices, WORDS * (slice + 1) / slices))
+									changed.store(true, std::memory_order_relaxed);
+							});
+						batch.Wait();
+					}
+					else
+						changed = BuildWords(table, 0, WORDS);
+					if (not changed)
+						break;
+				}
+			}
+		}
+
+		uint64_t Checksum(const std::vector<uint64_t>& words) {
+			uint64_t checksum = 0xcbf29ce484222325ULL;
+			for (uint64_t word : words)
+				checksum = (checksum ^ word) * 0x100000001b3ULL;
+			return checksum;
+		}
+
+		// magic, version, the words of every table and their checksum
+		bool Load(const std::string& path) {
+			std::ifstream file(path, std::ios::binary);
+			char magic[sizeof(CACHE_MAGIC)];
+			uint32_t version = 0;
+			std::vector<uint64_t> words(TABLE_COUNT * WORDS);
+			uint64_t checksum = 0;
+			if (not file.read(magic, sizeof(magic)) or not file.read(reinterpret_cast<char*>(&version), sizeof(version)) or
+				not std::equal(magic, magic + sizeof(magic), CACHE_MAGIC) or version != CACHE_VERSION or
+				not file.read(reinterpret_cast<char*>(words.data()), (std::streamsize)(words.size() * sizeof(uint64_t))) or
+				not file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum)) or checksum != Checksum(words))
+				return false;
+
+			for (size_t i = 0; i < words.size(); i++)
+				s_Tables[i / WORDS][i % WORDS].store(words[i], std::memory_order_relaxed);
+			return true;
+		}
+
+		// written next to the cache and renamed over it, so a reader never sees half a file
+		void Save(const std::string& path) {
+			std::vector<uint64_t> words(TABLE_COUNT * WORDS);
+			for (size_t i = 0; i < words.size(); i++)
+				words[i] = s_Tables[i / WORDS][i % WORDS].load(std::memory_order_relaxed);
+			uint64_t checksum = Checksum(words);
+
+			std::string temporary = path + ".tmp";
+			{
+				std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+				file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+				file.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+				file.write(reinterpret_cast<const char*>(words.data()), (std::streamsize)(words.size() * sizeof(uint64_t)));
+				file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+				if (not file)
+					return;
+			}
+			std::error_code error;
+			std::filesystem::rename(temporary, path, error);
+		}
+	}
+
+	void SetCachePath(std::string path) {
+		s_CachePath = std::move(path);
+	}
+
+	void Init(ThreadPool* pool) {
+		std::call_once(s_InitFlag, [pool] {
+			auto start = std::chrono::steady_clock::now();
+			if (not s_CachePath.empty() and Load(s_CachePath))
+				s_Stats.fromCache = true;
+			else {
+				Build(pool);
+				if (not s_CachePath.empty())
+					Save(s_CachePath);
+			}
+
+			for (Table table : {KPK, KRK, KQK})
+				for (const std::atomic<uint64_t>& word : s_Tables[table])
+					s_Stats.wins[table] += std::popcount(word.load(std::memory_order_relaxed));
+			s_Stats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			s_Ready.store(true, std::memory_order_release);
+		});
+	}
+
+	bool IsReady() {
+		return s_Ready.load(std::memory_order_acquire);
+	}
+
+	const BuildStats& GetBuildStats() {
+		return s_Stats;
+	}
+
+	std::optional<Wdl> Probe(const RawBoard& board, Player toMove) {
+		uint64_t occupied = Board::GetOccupancy(board);
+		if (std::popcount(occupied) != 3 or not IsReady())
+			return std::nullopt;
+
+		int whiteKing = -1, blackKing = -1, piece = -1;
+		char type = ' ';
+		for (; occupied; occupied &= occupied - 1) {
+			int square = std::countr_zero(occupied);
+			char letter = board[square];
+			if (letter == 'K')
+				whiteKing = square;
+			else if (letter == 'k')
+				blackKing = square;
+			else {
+				piece = square;
+				type = letter;
+			}
+		}
+		if (whiteKing < 0 or blackKing < 0)
+			return std::nullopt;
+
+		Table table;
+		switch (type | 0x20) {
+			case 'p': table = KPK; break;
+			case 'r': table = KRK; break;
+			case 'q': table = KQK; break;
+			default: return std::nullopt;
+		}
+
+		// black's piece is seen from its side, flipping the board so its pawn also goes up
+		bool strongIsWhite = type != (type | 0x20);
+		bool strongToMove = (toMove == Player::White) == strongIsWhite;
+		int index = strongIsWhite ? Index(strongToMove, whiteKing, blackKing, piece) :
+					Index(strongToMove, blackKing ^ 56, whiteKing ^ 56, piece ^ 56);
+		if (not IsWin(table, index))
+			return Wdl::Draw;
+		return strongToMove ? Wdl::Win : Wdl::Loss;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Board.h"
+
+class ThreadPool;
+
+// exact win or draw answers for the endings with the two kings and one more piece, KPK, KRK and KQK
+// built once per process by retrograde analysis, one bit per position: does the side with the piece win
+// the weak side can never win these, it can only hold the draw
+namespace Bitbases {
+	enum class Wdl : int8_t {
+		Loss = -1, Draw = 0, Win = 1
+	};
+
+	// how long building or loading the tables took, and how many positions are wins
+	struct BuildStats {
+		double timeMs = 0;
+		bool fromCache = false;
+		int passes = 0;
+		// positions won by the side with the piece, in KQK, KRK and KPK
+		std::array<uint64_t, 3> wins{};
+	};
+
+	// the tables are read from this file if it holds them, and written to it after they are built
+	void SetCachePath(std::string path);
+	// builds the tables on the pool, or on the calling thread without one
+	// only the first call does anything, the others wait for it and return right away
+	void Init(ThreadPool* pool = nullptr);
+	[[nodiscard]] bool IsReady();
+	[[nodiscard]] const BuildStats& GetBuildStats();
+
+	// for the side to move, nullopt if the position isn't one of the tables or they are not built yet
+	[[nodiscard]] std::optional<Wdl> Probe(const RawBoard& board, Player toMove);
+
+	template<BoardRepresentation B>
+	[[nodiscard]] std::optional<Wdl> Probe(const B& board) {
+		if constexpr (requires { { board.GetRawBoard() } -> std::convertible_to<const RawBoard&>; })
+			return Probe(board.GetRawBoard(), board.GetCurrentPlayer());
+		else {
+			RawBoard raw;
+			for (int i = 0; i < B::SIZE * B::SIZE; i++)
+				raw[i] = board[i];
+			return Probe(raw, board.GetCurrentPlayer());
+		}
+	}
+}
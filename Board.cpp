@@ -1,13 +1,190 @@
 #include "pch.h"
 #include "Board.h"
 
-Board::Board(const std::string& fen)
-	:m_Board(BoardFromFen(fen)), m_Playing(fen.contains(" w ") ? Player::White : Player::Black),
-	 m_EnPassant(ParseEnPassantFromFen(fen)),
-	 m_WhiteCastlingRights(ParseCastlingRightsFromFen(fen, Player::White)),
-	 m_BlackCastlingRights(ParseCastlingRightsFromFen(fen, Player::Black))
+#include <immintrin.h>
+
+Board::Board(std::string_view fen) {
+	ParseFen(fen);
+}
+
+Board::Board(const PackedPosition& packed) {
+	m_Board.fill(' ');
+
+	// the pieces are stored in the order of the occupied squares
+	uint64_t occupancy = packed.occupancy;
+	for (int nibble = 0; occupancy; nibble++, occupancy &= occupancy - 1) {
+		int index = std::countr_zero(occupancy);
+		char piece = PackedPosition::CodeToPiece(packed.pieces[nibble / 2] >> (4 * (nibble % 2)));
+		m_Board[index] = piece;
+		if (piece == 'K')
+			m_KingIndex[static_cast<int>(Player::White)] = index;
+		else if (piece == 'k')
+			m_KingIndex[static_cast<int>(Player::Black)] = index;
+	}
+
+	m_Playing = packed.flags & PackedPosition::BLACK_TO_MOVE ? Player::Black : Player::White;
+	m_WhiteCastlingRights = {packed.flags & PackedPosition::WHITE_KING_SIDE, packed.flags & PackedPosition::WHITE_QUEEN_SIDE};
+	m_BlackCastlingRights = {packed.flags & PackedPosition::BLACK_KING_SIDE, packed.flags & PackedPosition::BLACK_QUEEN_SIDE};
+
+	// the pawn that can be taken en passant belongs to the player who is not playing
+	if (packed.enPassant)
+		m_EnPassant = Coord({packed.enPassant - 1, IsWhiteTurn() ? 5 : 2});
+	m_halfMovesRule = packed.halfMoves;
+	m_fullMoves = packed.fullMoves;
+}
+
+PackedPosition Board::Pack() const {
+	PackedPosition packed;
+
+	uint64_t occupancy = 0;
+	for (int index = 0; index < SIZE * SIZE; index++)
+		if (m_Board[index] != ' ')
+			occupancy |= 1ULL << index;
+
+	// a legal position never has more than 32 pieces
+	int nibble = 0;
+	for (uint64_t remaining = occupancy; remaining and nibble < 32; remaining &= remaining - 1, nibble++) {
+		uint8_t code = PackedPosition::PieceToCode(m_Board[std::countr_zero(remaining)]);
+		packed.pieces[nibble / 2] |= code << (4 * (nibble % 2));
+		packed.occupancy |= remaining & -remaining;
+	}
+
+	packed.flags = (IsWhiteTurn() ? 0 : PackedPosition::BLACK_TO_MOVE) |
+				   (m_WhiteCastlingRights.first ? PackedPosition::WHITE_KING_SIDE : 0) |
+				   (m_WhiteCastlingRights.second ? PackedPosition::WHITE_QUEEN_SIDE : 0) |
+				   (m_BlackCastlingRights.first ? PackedPosition::BLACK_KING_SIDE : 0) |
+				   (m_BlackCastlingRights.second ? PackedPosition::BLACK_QUEEN_SIDE : 0);
+	packed.enPassant = m_EnPassant ? m_EnPassant->first + 1 : 0;
+	packed.halfMoves = (uint8_t)std::min(m_halfMovesRule, 255);
+	packed.fullMoves = (uint16_t)std::min(m_fullMoves, 65535);
+	return packed;
+}
+
+uint64_t Board::GetHash() const {
+	if (m_Hash)
+		return m_Hash.value();
+
+	const Zobrist::Keys& keys = Zobrist::KEYS;
+	uint64_t hash = 0;
+	for (int index = 0; index < SIZE * SIZE; index++)
+		hash ^= keys.pieces[PackedPosition::PieceToCode(m_Board[index])][index];
+
+	if (not IsWhiteTurn())
+		hash ^= keys.blackToMove;
+	if (m_WhiteCastlingRights.first)
+		hash ^= keys.castling[0];
+	if (m_WhiteCastlingRights.second)
+		hash ^= keys.castling[1];
+	if (m_BlackCastlingRights.first)
+		hash ^= keys.castling[2];
+	if (m_BlackCastlingRights.second)
+		hash ^= keys.castling[3];
+	if (m_EnPassant)
+		hash ^= keys.enPassant[m_EnPassant->first];
+
+	m_Hash = hash;
+	return hash;
+}
+
+// reads all the fields of the fen in a single pass, the clocks are optional
+void Board::ParseFen(std::string_view fen) {
+	size_t i = 0;
+	auto skipSpaces = [&] {
+		while (i < fen.size() and fen[i] == ' ')
+			i++;
+	};
+
+	// piece placement, from a8 to h1
+	int index = 0;
+	for (; i < fen.size() and fen[i] != ' '; i++) {
+		char c = fen[i];
+		if (c == '/')
+			continue;
+		if ('1' <= c and c <= '8') {
+			for (int n = 0; n < c - '0' and index < SIZE * SIZE; n++)
+				m_Board[index++] = ' ';
+			continue;
+		}
+		if (not PackedPosition::PieceToCode(c) or index >= SIZE * SIZE)
+			throw std::runtime_error("Invalid FEN string");
+		if (c == 'K')
+			m_KingIndex[static_cast<int>(Player::White)] = index;
+		else if (c == 'k')
+			m_KingIndex[static_cast<int>(Player::Black)] = index;
+		m_Board[index++] = c;
+	}
+	if (index != SIZE * SIZE)
+		throw std::runtime_error("Invalid FEN string");
+
+	// side to move
+	skipSpaces();
+	m_Playing = i < fen.size() and fen[i] == 'b' ? Player::Black : Player::White;
+	if (i < fen.size())
+		i++;
+
+	// castling rights
+	skipSpaces();
+	m_WhiteCastlingRights = {false, false};
+	m_BlackCastlingRights = {false, false};
+	for (; i < fen.size() and fen[i] != ' '; i++) {
+		switch (fen[i]) {
+			case 'K': m_WhiteCastlingRights.first = true; break;
+			case 'Q': m_WhiteCastlingRights.second = true; break;
+			case 'k': m_BlackCastlingRights.first = true; break;
+			case 'q': m_BlackCastlingRights.second = true; break;
+			default: break;
+		}
+	}
+
+	// en passant square
+	skipSpaces();
+	m_EnPassant = {};
+	if (i + 1 < fen.size() and 'a' <= fen[i] and fen[i] <= 'h' and '1' <= fen[i + 1] and fen[i + 1] <= '8') {
+		m_EnPassant = Chess2Coord(&fen[i]);
+		i += 2;
+	} else if (i < fen.size()) {
+		i++;
+	}
+
+	// half move clock and full move number
+	skipSpaces();
+	auto result = std::from_chars(fen.data() + i, fen.data() + fen.size(), m_halfMovesRule);
+	i = result.ptr - fen.data();
+	skipSpaces();
+	std::from_chars(fen.data() + i, fen.data() + fen.size(), m_fullMoves);
+}
+
+Board::Board(const Board& other)
+	:m_Board(other.m_Board), m_EnPassant(other.m_EnPassant),
+	 m_WhiteCastlingRights(other.m_WhiteCastlingRights), m_BlackCastlingRights(other.m_BlackCastlingRights),
+	 m_Playing(other.m_Playing), m_halfMovesRule(other.m_halfMovesRule), m_fullMoves(other.m_fullMoves),
+	 m_KingIndex(other.m_KingIndex)
 {}
 
+Board& Board::operator=(const Board& other) {
+	if (this == &other)
+		return *this;
+
+	m_Board = other.m_Board;
+	m_EnPassant = other.m_EnPassant;
+	m_WhiteCastlingRights = other.m_WhiteCastlingRights;
+	m_BlackCastlingRights = other.m_BlackCastlingRights;
+	m_Playing = other.m_Playing;
+	m_halfMovesRule = other.m_halfMovesRule;
+	m_fullMoves = other.m_fullMoves;
+	m_KingIndex = other.m_KingIndex;
+	InvalidateDerivedState();
+	return *this;
+}
+
+void Board::InvalidateDerivedState() {
+	m_LegalMoves.reset();
+	m_Checkers.reset();
+	m_IsCheck.reset();
+	m_Status.reset();
+	m_Hash.reset();
+}
+
 std::ostream& operator<<(std::ostream& ostream, const Board& board) {
 	int rowCount = Board::SIZE;
 	ostream << rowCount-- << " | ";
@@ -44,6 +221,9 @@ void Board::ApplyMove(const Move& move) {
 	else
 		m_halfMovesRule++;
 
+	// the en passant square only lives for one move
+	m_EnPassant = {};
+
 	// if a white pawn moved two ranks
 	if (pieceToMove == 'P' and from.second == 1 and to.second == 3) {
 		// if there are black pawns on the side
@@ -54,12 +234,16 @@ void Board::ApplyMove(const Move& move) {
 		if (to.first - 1 >= 0 and GetPiece(to.first - 1, 4) == 'P' ||
 			to.first + 1 <= 7 and GetPiece(to.first + 1, 4) == 'P')
 			m_EnPassant = Coord({to.first, 5});
-	} else {
-		m_EnPassant = {};
 	}
 
 	UpdateCastlingRights(move);
 
+	// keep track of the kings
+	if (pieceToMove == 'K')
+		m_KingIndex[static_cast<int>(Player::White)] = CoordToIndexInBoard(to.first, to.second);
+	else if (pieceToMove == 'k')
+		m_KingIndex[static_cast<int>(Player::Black)] = CoordToIndexInBoard(to.first, to.second);
+
 	// if the move played was en passant, remove the correct piece
 	if (pieceToMove == 'p' and pieceToReplace == ' ' and from.first != to.first)
 			GetPieceRef(to.first, to.second + 1) = ' ';
@@ -93,497 +277,546 @@ void Board::ApplyMove(const Move& move) {
 	if (m_Playing == Player::Black)
 		m_fullMoves++;
 	m_Playing = GetNotCurrentPlayer();
+	InvalidateDerivedState();
 }
 
-unsigned long Board::s_LegalMovesCacheHits = 0;
-unsigned long Board::s_LegalMovesCacheMisses = 0;
-std::shared_timed_mutex Board::s_CacheMutex;
-std::unordered_map<std::string, std::vector<Move>> Board::s_FenToLegalMovesCache;
+void Board::ApplyNullMove() {
+	m_EnPassant = {};
+	m_halfMovesRule++;
+	if (m_Playing == Player::Black)
+		m_fullMoves++;
+	m_Playing = GetNotCurrentPlayer();
+	InvalidateDerivedState();
+}
 
-// Check all the pseudo legal moves and remove the ones that violate the check rules
-const std::vector<Move>& Board::GetLegalMoves() const {
-	PROFILE_SCOPE;
-	std::string fen = GetPositionalFen();
-	{
-		std::shared_lock lock(s_CacheMutex);
-		if (s_FenToLegalMovesCache.contains(fen)) {
-			s_LegalMovesCacheHits++;
-			return s_FenToLegalMovesCache.at(fen);
-		}
-	}
+bool Board::IsCapture(const Move& move) const {
+	if (GetPiece(move.to) != ' ')
+		return true;
+	// a pawn moving diagonally to an empty square takes en passant
+	char piece = GetPiece(move.from);
+	return (piece == 'P' or piece == 'p') and move.from.first != move.to.first;
+}
 
-	s_LegalMovesCacheMisses++;
-	std::vector<Move> moves = GetPseudoLegalMoves();
-	auto it = moves.begin();
-	while (it != moves.end()) {
+bool Board::HasNonPawnMaterial(Player player) const {
+	return player == Player::White ? HasNonPawnMaterial<Player::White>() : HasNonPawnMaterial<Player::Black>();
+}
 
-		// if the move is a castling move, check if it's legal
-		char piece = GetPiece(it->from);
-		if ((piece == 'K' or piece == 'k') and std::abs(it->from.first - it->to.first) > 1) {
-			if (not IsCastlingLegal(it->to.first == 6)) {
-				it = moves.erase(it); // catch the new iterator
-				continue;
-			}
+namespace {
+	// the material values of the evaluation in centipawns, the king is worth more than everything else together
+	consteval std::array<int, 128> GenerateExchangeValues() {
+		std::array<int, 128> values{};
+		for (auto [piece, value] : {std::pair{'p', 100}, {'n', 300}, {'b', 300}, {'r', 500}, {'q', 900}, {'k', 10000}}) {
+			values[piece] = value;
+			values[piece - 'a' + 'A'] = value;
 		}
-
-		Board copy = *this;
-		// make sure the move does not put the king in check
-		copy.ApplyMove(*it);
-		copy.m_Playing = GetCurrentPlayer();
-
-		if (copy.IsCheck())
-			it = moves.erase(it); // catch the new iterator
-		else
-			it++;
-	}
-
-	{
-		std::lock_guard lock(s_CacheMutex);
-		s_FenToLegalMovesCache[fen] = moves;
-		return s_FenToLegalMovesCache[fen];
+		return values;
 	}
+	constexpr std::array<int, 128> EXCHANGE_VALUES = GenerateExchangeValues();
 }
 
-// generate all the legal moves for the current player regardless of the king being in check
-std::vector<Move> Board::GetPseudoLegalMoves() const {
-	std::vector<Move> legalMoves;
-	for (int col = 0; col < SIZE; col++)
-		for (int row = 0; row < SIZE; row++) {
-			char piece = GetPiece(col, row);
+int Board::StaticExchange(const Move& move) const {
+	const int from = CoordToIndexInBoard(move.from.first, move.from.second);
+	const int to = CoordToIndexInBoard(move.to.first, move.to.second);
+	const char piece = m_Board[from];
+
+	// gain[i] is what the side making the i-th capture is up if the exchange stops right after it
+	std::array<int, 32> gain{};
+	gain[0] = EXCHANGE_VALUES[m_Board[to] & 0x7f];
+	uint64_t occupied = GetOccupancy(m_Board) & ~(1ULL << from);
+	if ((piece == 'P' or piece == 'p') and m_Board[to] == ' ' and move.from.first != move.to.first) {
+		gain[0] = EXCHANGE_VALUES['p'];
+		occupied &= ~(1ULL << CoordToIndexInBoard(move.to.first, move.from.second));
+	}
+	char onSquare = piece;
+	if (move.promote) {
+		gain[0] += EXCHANGE_VALUES[move.promote.value() & 0x7f] - EXCHANGE_VALUES['p'];
+		onSquare = move.promote.value();
+	}
 
-			if (not IsPlayerPiece(piece, GetCurrentPlayer())) continue;
+	uint64_t attackers = GetAttackersTo(to, occupied);
+	bool whiteTakes = not IsPlayerPiece<Player::White>(piece);
+	int captures = 0;
+	while (captures + 1 < (int)gain.size()) {
+		// the least valuable piece of the side to take, the king last
+		int square = -1;
+		for (uint64_t remaining = attackers & occupied; remaining; remaining &= remaining - 1) {
+			int candidate = std::countr_zero(remaining);
+			if (IsPlayerPiece<Player::White>(m_Board[candidate]) == whiteTakes and
+				(square < 0 or EXCHANGE_VALUES[m_Board[candidate]] < EXCHANGE_VALUES[m_Board[square]]))
+				square = candidate;
+		}
+		if (square < 0)
+			break;
 
-			const auto& moves = GetLegalMovesForPiece(col, row);
-			legalMoves.insert(legalMoves.end(), moves.begin(), moves.end());
+		occupied &= ~(1ULL << square);
+		// a slider behind the piece that just took can take next
+		int direction = AttackTables::DIRECTION[to][square];
+		if (direction >= 0) {
+			const AttackTables::Ray& ray = AttackTables::RAYS[to][direction];
+			for (int i = 0; i < ray.length; i++) {
+				if (not (occupied >> ray.squares[i] & 1))
+					continue;
+				char behind = (char)(m_Board[ray.squares[i]] | 0x20);
+				if (behind == 'q' or behind == (direction < 4 ? 'r' : 'b'))
+					attackers |= 1ULL << ray.squares[i];
+				break;
+			}
 		}
-	return legalMoves;
-}
 
-std::vector<Move> Board::GetLegalMovesForPiece(int col, int row) const {
-	std::vector<Move> legalMoves;
+		// the king can only take a piece nobody defends anymore
+		if ((m_Board[square] | 0x20) == 'k') {
+			bool defended = false;
+			for (uint64_t remaining = attackers & occupied; remaining; remaining &= remaining - 1)
+				defended |= IsPlayerPiece<Player::White>(m_Board[std::countr_zero(remaining)]) != whiteTakes;
+			if (defended)
+				break;
+		}
 
-	switch (GetPiece(col, row)) {
-		case 'r':
-		case 'R':
-			return GetPseudoLegalMovesRook(col, row);
-		case 'n':
-		case 'N':
-			return GetPseudoLegalMovesKnight(col, row);
-		case 'b':
-		case 'B':
-			return GetPseudoLegalMovesBishop(col, row);
-		case 'q':
-		case 'Q':
-			return GetPseudoLegalMovesQueen(col, row);
-		case 'k':
-		case 'K':
-			return GetPseudoLegalMovesKing(col, row);
-		case 'p':
-		case 'P':
-			return GetPseudoLegalMovesPawn(col, row);
-		default:
-			std::cout << "This should never happen! (Invalid Piece)" << std::endl;
+		captures++;
+		gain[captures] = EXCHANGE_VALUES[onSquare & 0x7f] - gain[captures - 1];
+		onSquare = m_Board[square];
+		whiteTakes = not whiteTakes;
 	}
 
-	// should never reach this code
-	return {};
+	// going backwards, each side only takes if that is better than stopping
+	for (; captures > 0; captures--)
+		gain[captures - 1] = -std::max(-gain[captures - 1], gain[captures]);
+	return gain[0];
 }
 
-std::vector<Move> Board::GetPseudoLegalMovesRook(int col, int row) const {
-	std::vector<Move> moves;
-
-	// scan to the right
-	for (int xd = 1; xd < SIZE - col; xd++) {
-		char piece = GetPiece(col + xd, row);
+uint64_t Board::GetAttackersTo(int index, uint64_t occupied) const {
+	uint64_t attackers = 0;
 
-		// if there is a piece blocking the scan, the scan stops
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
+	const AttackTables::Leaper& knights = AttackTables::KNIGHT[index];
+	for (int i = 0; i < knights.count; i++)
+		if ((m_Board[knights.squares[i]] | 0x20) == 'n')
+			attackers |= 1ULL << knights.squares[i];
 
-		moves.emplace_back(Coord({col, row}), Coord({col + xd, row}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
-			break;
+	for (Player by : {Player::White, Player::Black}) {
+		const char pawn = by == Player::White ? 'P' : 'p';
+		const AttackTables::Leaper& pawns = AttackTables::PAWN_ATTACKERS[static_cast<int>(by)][index];
+		for (int i = 0; i < pawns.count; i++)
+			if (m_Board[pawns.squares[i]] == pawn)
+				attackers |= 1ULL << pawns.squares[i];
 	}
 
-	// scan up
-	for (int yd = 1; yd < SIZE - row; yd++) {
-		char piece = GetPiece(col, row + yd);
+	const AttackTables::Leaper& kings = AttackTables::KING[index];
+	for (int i = 0; i < kings.count; i++)
+		if ((m_Board[kings.squares[i]] | 0x20) == 'k')
+			attackers |= 1ULL << kings.squares[i];
 
-		// if there is a piece blocking the scan, the scan stops
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
-
-		moves.emplace_back(Coord({col, row}), Coord({col, row + yd}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
+	for (int direction = 0; direction < AttackTables::DIRECTION_COUNT; direction++) {
+		const char slider = direction < 4 ? 'r' : 'b';
+		const AttackTables::Ray& ray = AttackTables::RAYS[index][direction];
+		for (int i = 0; i < ray.length; i++) {
+			if (not (occupied >> ray.squares[i] & 1))
+				continue;
+			char piece = (char)(m_Board[ray.squares[i]] | 0x20);
+			if (piece == slider or piece == 'q')
+				attackers |= 1ULL << ray.squares[i];
 			break;
+		}
 	}
 
-	// scan to the left
-	for (int xd = -1; xd >= -col; xd--) {
-		char piece = GetPiece(col + xd, row);
-
-		// if there is a piece blocking the scan, the scan stops
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
+	return attackers & occupied;
+}
 
-		moves.emplace_back(Coord({col, row}), Coord({col + xd, row}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
-			break;
-	}
+uint64_t Board::GetOccupancy(const RawBoard& board) {
+#ifdef __AVX2__
+	const __m256i empty = _mm256_set1_epi8(' ');
+	__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(board.data()));
+	__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(board.data() + 32));
+	uint32_t lowEmpty = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, empty));
+	uint32_t highEmpty = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, empty));
+	return ~((uint64_t)highEmpty << 32 | lowEmpty);
+#else
+	uint64_t occupied = 0;
+	for (int i = 0; i < 64; i++)
+		if (board[i] != ' ')
+			occupied |= 1ULL << i;
+	return occupied;
+#endif
+}
 
-	// scan down
-	for (int yd = -1; yd >= -row; yd--) {
-		char piece = GetPiece(col, row + yd);
+template<Player P>
+bool Board::HasNonPawnMaterial() const {
+	for (char piece : m_Board)
+		if (IsPlayerPiece<P>(piece) and piece != PlayerPiece<P>('p') and piece != PlayerPiece<P>('k'))
+			return true;
+	return false;
+}
 
-		// if there is a piece blocking the scan, the scan stops
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
+// Check all the pseudo legal moves and remove the ones that violate the check rules
+const std::vector<Move>& Board::GetLegalMoves() const {
+	if (m_LegalMoves)
+		return m_LegalMoves.value();
 
-		moves.emplace_back(Coord({col, row}), Coord({col, row + yd}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
-			break;
+	PROFILE_SCOPE;
+	PERF_PHASE(SearchPhase::MoveGeneration);
+	std::vector<Move> moves;
+	if (IsWhiteTurn()) {
+		GeneratePseudoLegalMoves<Player::White>(moves);
+		RemoveIllegalMoves<Player::White>(moves);
+	} else {
+		GeneratePseudoLegalMoves<Player::Black>(moves);
+		RemoveIllegalMoves<Player::Black>(moves);
 	}
 
-	return moves;
+	m_LegalMoves = std::move(moves);
+	return m_LegalMoves.value();
 }
 
-std::vector<Move> Board::GetPseudoLegalMovesKnight(int col, int row) const {
-	std::vector<Move> moves;
+template<Player P>
+void Board::RemoveIllegalMoves(std::vector<Move>& moves) const {
+	const int king = m_KingIndex[static_cast<int>(P)];
+	const bool check = IsCheck();
+	uint64_t occupancy = 0;
+	for (int index = 0; index < SIZE * SIZE; index++)
+		occupancy |= (uint64_t)(m_Board[index] != ' ') << index;
 
-	// check the moves one up and one down from the squares two left and two right
-	for (int xd = -2; xd <= 2; xd += 4)
-		for (int yd = -1; yd <= 1; yd+=2) {
-			int x = col + xd;
-			int y = row + yd;
-			if (0 <= x and x <= 7 and 0 <= y and y <= 7)
-				if (not IsPlayerPiece(GetPiece(x, y), GetCurrentPlayer()))
-					moves.emplace_back(Coord({col, row}), Coord({x, y}));
-		}
+	std::erase_if(moves, [&](const Move& move) {
+		const int from = CoordToIndexInBoard(move.from.first, move.from.second);
+		const int to = CoordToIndexInBoard(move.to.first, move.to.second);
+		const char piece = m_Board[from];
 
-	// check the moves one left and one right from the squares two up and two down
-	for (int xd = -1; xd <= 1; xd += 2)
-		for (int yd = -2; yd <= 2; yd+=4) {
-			int x = col + xd;
-			int y = row + yd;
-			// if the position is in bounds
-			if (0 <= x and x <= 7 and 0 <= y and y <= 7)
-				if (not IsPlayerPiece(GetPiece(x, y), GetCurrentPlayer()))
-					moves.emplace_back(Coord({col, row}), Coord({x, y}));
+		// if the move is a castling move, check if it's legal
+		if (piece == PlayerPiece<P>('k') and std::abs(move.from.first - move.to.first) > 1 and
+			not IsCastlingLegal<P>(move.to.first == 6))
+			return true;
+
+		// out of check, a piece can only expose its king by leaving the line between it and an enemy slider
+		// en passant takes a second piece off the board, so it always gets the full test
+		const bool enPassant = piece == PlayerPiece<P>('p') and move.from.first != move.to.first and m_Board[to] == ' ';
+		if (not check and king >= 0 and piece != PlayerPiece<P>('k') and not enPassant) {
+			const uint64_t line = AttackTables::LINE[king][from];
+			if (not line or line >> to & 1 or AttackTables::BETWEEN[king][from] & occupancy)
+				return false;
 		}
 
-	return moves;
+		// make sure the move does not put the king in check
+		Board copy = *this;
+		copy.ApplyMove(move);
+		const int movedKing = copy.m_KingIndex[static_cast<int>(P)];
+		return movedKing >= 0 and copy.IsSquareAttacked<Opponent<P>>(movedKing);
+	});
 }
 
-std::vector<Move> Board::GetPseudoLegalMovesBishop(int col, int row) const {
+// generate all the legal moves for the current player regardless of the king being in check
+std::vector<Move> Board::GetPseudoLegalMoves() const {
 	std::vector<Move> moves;
+	if (IsWhiteTurn())
+		GeneratePseudoLegalMoves<Player::White>(moves);
+	else
+		GeneratePseudoLegalMoves<Player::Black>(moves);
+	return moves;
+}
 
-	// scan up right
-	for (int d = 1; col + d < 8 and row + d < 8; d++) {
-		char piece = GetPiece(col + d, row + d);
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
-
-		moves.emplace_back(Coord({col, row}), Coord({col + d, row + d}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
-			break;
-	}
-
-	// scan up left
-	for (int d = 1; col - d >= 0 and row + d < 8; d++) {
-		char piece = GetPiece(col - d, row + d);
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
-
-		moves.emplace_back(Coord({col, row}), Coord({col - d, row + d}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
-			break;
-	}
-
-	// scan down right
-	for (int d = 1; col + d < 8 and row - d >= 0; d++) {
-		char piece = GetPiece(col + d, row - d);
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
+template<Player P>
+void Board::GeneratePseudoLegalMoves(std::vector<Move>& moves) const {
+	for (int col = 0; col < SIZE; col++)
+		for (int row = 0; row < SIZE; row++)
+			if (IsPlayerPiece<P>(GetPiece(col, row)))
+				GenerateMovesForPiece<P>(col, row, moves);
+}
 
-		moves.emplace_back(Coord({col, row}), Coord({col + d, row - d}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
-			break;
+template<Player P>
+void Board::GenerateMovesForPiece(int col, int row, std::vector<Move>& moves) const {
+	switch (GetPiece(col, row)) {
+		case PlayerPiece<P>('r'):
+			return GenerateRookMoves<P>(col, row, moves);
+		case PlayerPiece<P>('n'):
+			return GenerateKnightMoves<P>(col, row, moves);
+		case PlayerPiece<P>('b'):
+			return GenerateBishopMoves<P>(col, row, moves);
+		case PlayerPiece<P>('q'):
+			GenerateRookMoves<P>(col, row, moves);
+			return GenerateBishopMoves<P>(col, row, moves);
+		case PlayerPiece<P>('k'):
+			return GenerateKingMoves<P>(col, row, moves);
+		case PlayerPiece<P>('p'):
+			return GeneratePawnMoves<P>(col, row, moves);
+		default:
+			std::cout << "This should never happen! (Invalid Piece)" << std::endl;
 	}
+}
 
-	// scan down left
-	for (int d = 1; col - d >= 0 and row - d >= 0; d++) {
-		char piece = GetPiece(col - d, row - d);
-		if (IsPlayerPiece(piece, GetCurrentPlayer()))
-			break;
+template<Player P>
+void Board::GenerateRookMoves(int col, int row, std::vector<Move>& moves) const {
+	// scan right, up, left and down until a piece blocks the scan
+	// an opponent's piece can be taken, ours can't
+	for (auto [dx, dy] : {std::pair{1, 0}, {0, 1}, {-1, 0}, {0, -1}})
+		for (int x = col + dx, y = row + dy; 0 <= x and x < SIZE and 0 <= y and y < SIZE; x += dx, y += dy) {
+			char piece = GetPiece(x, y);
+			if (IsPlayerPiece<P>(piece))
+				break;
+			moves.emplace_back(Coord({col, row}), Coord({x, y}));
+			if (piece != ' ')
+				break;
+		}
+}
 
-		moves.emplace_back(Coord({col, row}), Coord({col - d, row - d}));
-		// if the piece was an opponent's piece, the scan stops
-		if (piece != ' ')
-			break;
+template<Player P>
+void Board::GenerateKnightMoves(int col, int row, std::vector<Move>& moves) const {
+	// one up and one down from the squares two left and two right, then one left and one right from two up and two down
+	for (auto [dx, dy] : {std::pair{-2, -1}, {-2, 1}, {2, -1}, {2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}}) {
+		int x = col + dx;
+		int y = row + dy;
+		if (0 <= x and x < SIZE and 0 <= y and y < SIZE and not IsPlayerPiece<P>(GetPiece(x, y)))
+			moves.emplace_back(Coord({col, row}), Coord({x, y}));
 	}
-
-	return moves;
 }
 
-std::vector<Move> Board::GetPseudoLegalMovesQueen(int col, int row) const {
-	// get the rook moves
-	std::vector<Move> moves = GetPseudoLegalMovesRook(col, row);
-
-	// append the bishop moves
-	const std::vector<Move>& temp = GetPseudoLegalMovesBishop(col, row);
-	moves.insert(moves.end(), temp.begin(), temp.end());
-
-	return moves;
+template<Player P>
+void Board::GenerateBishopMoves(int col, int row, std::vector<Move>& moves) const {
+	// scan up right, up left, down right and down left
+	for (auto [dx, dy] : {std::pair{1, 1}, {-1, 1}, {1, -1}, {-1, -1}})
+		for (int x = col + dx, y = row + dy; 0 <= x and x < SIZE and 0 <= y and y < SIZE; x += dx, y += dy) {
+			char piece = GetPiece(x, y);
+			if (IsPlayerPiece<P>(piece))
+				break;
+			moves.emplace_back(Coord({col, row}), Coord({x, y}));
+			if (piece != ' ')
+				break;
+		}
 }
 
-std::vector<Move> Board::GetPseudoLegalMovesKing(int col, int row) const {
-	std::vector<Move> moves;
-
+template<Player P>
+void Board::GenerateKingMoves(int col, int row, std::vector<Move>& moves) const {
 	for (int dx = -1; dx <= 1; dx++)
 		for (int dy = -1; dy <= 1; dy++) {
 			int x = col + dx;
 			int y = row + dy;
-			// if the position is in bounds
-			if (0 <= x and x < 8 and 0 <= y and y < 8) {
-				if (not IsPlayerPiece(GetPiece(col + dx, row + dy), GetCurrentPlayer()))
-					moves.emplace_back(Coord({col, row}), Coord({x, y}));
-			}
+			// the king's own square holds one of our pieces, so it is skipped like the others
+			if (0 <= x and x < SIZE and 0 <= y and y < SIZE and not IsPlayerPiece<P>(GetPiece(x, y)))
+				moves.emplace_back(Coord({col, row}), Coord({x, y}));
 		}
 
-	// check castling
-	if (IsWhiteTurn()) {
-		// check white king side castling
-		if (m_WhiteCastlingRights.first and GetPiece(5, 0) == ' ' and GetPiece(6, 0) == ' ')
-			moves.emplace_back(Coord({col, row}), Coord({6, 0}));
-		// check white queen side castling
-		if (m_WhiteCastlingRights.second and GetPiece(1, 0) == ' ' and GetPiece(2, 0) == ' ' and GetPiece(3, 0) == ' ')
-			moves.emplace_back(Coord({col, row}), Coord({2, 0}));
-	} else {
-		// check black king side castling
-		if (m_BlackCastlingRights.first and GetPiece(5, 7) == ' ' and GetPiece(6, 7) == ' ')
-			moves.emplace_back(Coord({col, row}), Coord({6, 7}));
-		// check black queen side castling
-		if (m_BlackCastlingRights.second and GetPiece(1, 7) == ' ' and GetPiece(2, 7) == ' ' and GetPiece(3, 7) == ' ')
-			moves.emplace_back(Coord({col, row}), Coord({2, 7}));
-	}
-	return moves;
+	// check castling, king side then queen side
+	constexpr int backRow = P == Player::White ? 0 : 7;
+	const CastlingRights& rights = P == Player::White ? m_WhiteCastlingRights : m_BlackCastlingRights;
+	if (rights.first and GetPiece(5, backRow) == ' ' and GetPiece(6, backRow) == ' ')
+		moves.emplace_back(Coord({col, row}), Coord({6, backRow}));
+	if (rights.second and GetPiece(1, backRow) == ' ' and GetPiece(2, backRow) == ' ' and GetPiece(3, backRow) == ' ')
+		moves.emplace_back(Coord({col, row}), Coord({2, backRow}));
 }
 
-std::vector<Move> Board::GetPseudoLegalMovesPawn(int col, int row) const {
-	std::vector<Move> moves;
-
-	// Get some important information depending on the color playing
-	int dy;
-	int startingRow;
-
-	if (IsWhiteTurn()) {
-		startingRow = 1;
-		dy = 1;
-	} else {
-		startingRow = 6;
-		dy = -1;
-	}
-
-	// check one move ahead if the pawn can move
-	char piece = GetPiece(col, row + dy);
-	if (piece == ' ') {
-		// if white can promote
-		if (row + dy == 7)
-			for (char promote : std::string("QRBN"))
-				moves.emplace_back(Coord({col, row}), Coord({col, row + dy}), promote);
-			// if black can promote
-		else if (row + dy == 0)
-			for (char promote : std::string("qrbn"))
-				moves.emplace_back(Coord({col, row}), Coord({col, row + dy}), promote);
-			// if no one can promote
+template<Player P>
+void Board::GeneratePawnMoves(int col, int row, std::vector<Move>& moves) const {
+	constexpr int dy = P == Player::White ? 1 : -1;
+	constexpr int startingRow = P == Player::White ? 1 : 6;
+	constexpr int promotionRow = P == Player::White ? 7 : 0;
+	constexpr std::array<char, 4> promotions = {PlayerPiece<P>('q'), PlayerPiece<P>('r'), PlayerPiece<P>('b'), PlayerPiece<P>('n')};
+
+	auto add = [&](int x, int y) {
+		if (y == promotionRow)
+			for (char promote : promotions)
+				moves.emplace_back(Coord({col, row}), Coord({x, y}), promote);
 		else
-			moves.emplace_back(Coord({col, row}), Coord({col, row + dy}));
+			moves.emplace_back(Coord({col, row}), Coord({x, y}));
+	};
 
-		// if the pawn is on the starting line, check an additional move ahead
-		if (row == startingRow) {
-			piece = GetPiece(col, row + dy * 2);
-			if (piece == ' ')
-				moves.emplace_back(Coord({col, row}), Coord({col, row + dy * 2}));
-		}
+	// check one move ahead if the pawn can move
+	// and if the pawn is on the starting line, an additional move ahead
+	if (GetPiece(col, row + dy) == ' ') {
+		add(col, row + dy);
+		if (row == startingRow and GetPiece(col, row + dy * 2) == ' ')
+			moves.emplace_back(Coord({col, row}), Coord({col, row + dy * 2}));
 	}
 
-	// check if the pawn can take
+	// pawns can only move diagonally if they are taking a piece, en passant included
 	for (int x = col - 1; x <= col + 1; x += 2) {
-		// make sure we are not checking out of bounds
-		if (x > 7 or x < 0) continue;
+		if (x > 7 or x < 0)
+			continue;
 
 		int y = row + dy;
-		piece = GetPiece(x, y);
-		// pawns can only move diag if they are taking a piece
-		if (not IsPlayerPiece(piece, GetCurrentPlayer()) and piece != ' ') {
-			// if white can promote
-			if (row + dy == 7)
-				for (char promote : std::string("QRBN"))
-					moves.emplace_back(Coord({col, row}), Coord({x, y}), promote);
-				// if black can promote
-			else if (row + dy == 0)
-				for (char promote : std::string("qrbn"))
-					moves.emplace_back(Coord({col, row}), Coord({x, y}), promote);
-				// if no one can promote
-			else
-				moves.emplace_back(Coord({col, row}), Coord({x, y}));
-		}
+		char piece = GetPiece(x, y);
+		if (IsPlayerPiece<Opponent<P>>(piece))
+			add(x, y);
 
-		// check for en passant
-		if (m_EnPassant) {
-			const Coord& epCoord = m_EnPassant.value();
-			if (epCoord.first == x and epCoord.second == y)
-				moves.emplace_back(Coord({col, row}), Coord({x, y}));
-		}
+		if (m_EnPassant and m_EnPassant->first == x and m_EnPassant->second == y)
+			moves.emplace_back(Coord({col, row}), Coord({x, y}));
 	}
-
-	return moves;
 }
 
-bool Board::IsCheckmate() const {
-	return GetLegalMoves().empty() and IsCheck();
+GameStatus Board::GetStatus() const {
+	if (m_Status)
+		return m_Status.value();
+
+	if (GetLegalMoves().empty())
+		m_Status = IsCheck() ? GameStatus::Checkmate : GameStatus::Stalemate;
+	else if (m_halfMovesRule >= 100)
+		m_Status = GameStatus::FiftyMoves;
+	else
+		m_Status = GameStatus::Ongoing;
+	return m_Status.value();
 }
 
-bool Board::IsDraw() const {
-	if (m_halfMovesRule >= 100)
-		return true;
-	if (GetLegalMoves().empty() and not IsCheck())
-		return true;
-	return false;
+const std::vector<Coord>& Board::GetCheckers() const {
+	if (m_Checkers)
+		return m_Checkers.value();
+
+	int king = m_KingIndex[static_cast<int>(GetCurrentPlayer())];
+	if (king < 0 or not IsCheck())
+		m_Checkers = std::vector<Coord>();
+	else
+		m_Checkers = IsWhiteTurn() ? GetAttackers<Player::Black>(king) : GetAttackers<Player::White>(king);
+	return m_Checkers.value();
 }
 
 bool Board::IsCheck() const {
+	if (m_IsCheck)
+		return m_IsCheck.value();
+
 	PROFILE_SCOPE;
-	// kings coordinate
-	char myKing = IsWhiteTurn() ? 'K' : 'k';
-	// find the kings coordinate on the board
-	int kingCol = - 1, kingRow = -1;
-	for (int i = 0; i < Board::SIZE * Board::SIZE; i++) {
-		char piece = m_Board[i];
-		if (piece == myKing) {
-			kingCol = i % Board::SIZE;
-			kingRow = Board::SIZE - 1 - (i / Board::SIZE);
+	int king = m_KingIndex[static_cast<int>(GetCurrentPlayer())];
+	m_IsCheck = king >= 0 and IsSquareAttacked(king, GetNotCurrentPlayer());
+	return m_IsCheck.value();
+}
+
+bool Board::IsSquareAttacked(int index, Player by) const {
+	return by == Player::White ? IsSquareAttacked<Player::White>(index) : IsSquareAttacked<Player::Black>(index);
+}
+
+template<Player By>
+bool Board::IsSquareAttacked(int index) const {
+	constexpr char pawn = PlayerPiece<By>('p');
+	constexpr char knight = PlayerPiece<By>('n');
+	constexpr char bishop = PlayerPiece<By>('b');
+	constexpr char rook = PlayerPiece<By>('r');
+	constexpr char queen = PlayerPiece<By>('q');
+	constexpr char king = PlayerPiece<By>('k');
+
+	const AttackTables::Leaper& knights = AttackTables::KNIGHT[index];
+	for (int i = 0; i < knights.count; i++)
+		if (m_Board[knights.squares[i]] == knight)
+			return true;
+
+	const AttackTables::Leaper& pawns = AttackTables::PAWN_ATTACKERS[static_cast<int>(By)][index];
+	for (int i = 0; i < pawns.count; i++)
+		if (m_Board[pawns.squares[i]] == pawn)
+			return true;
+
+	const AttackTables::Leaper& kings = AttackTables::KING[index];
+	for (int i = 0; i < kings.count; i++)
+		if (m_Board[kings.squares[i]] == king)
+			return true;
+
+	// walk each ray until the first piece, it attacks the square if it slides in that direction
+	for (int direction = 0; direction < AttackTables::DIRECTION_COUNT; direction++) {
+		const char slider = direction < 4 ? rook : bishop;
+		const AttackTables::Ray& ray = AttackTables::RAYS[index][direction];
+		for (int i = 0; i < ray.length; i++) {
+			char piece = m_Board[ray.squares[i]];
+			if (piece == ' ')
+				continue;
+			if (piece == queen or piece == slider)
+				return true;
 			break;
 		}
 	}
 
-	// for each piece p
-	// if the king was a [p] could it eat a [p] of the other color?
-
-	char otherQueen = IsWhiteTurn() ? 'q' : 'Q';
-	bool queenChecking = std::ranges::any_of(GetPseudoLegalMovesQueen(kingCol, kingRow), [this, otherQueen](const Move& move) {
-		char piece = GetPiece(move.to);
-		return (piece == otherQueen);
-	});
-	if (queenChecking) return true;
-
-	char otherRook = IsWhiteTurn() ? 'r' : 'R';
-	bool rookChecking = std::ranges::any_of(GetPseudoLegalMovesRook(kingCol, kingRow), [this, otherRook](const Move& move) {
-		char piece = GetPiece(move.to);
-		return (piece == otherRook);
-	});
-
-	char otherBishop = IsWhiteTurn() ? 'b' : 'B';
-	bool bishopChecking = std::ranges::any_of(GetPseudoLegalMovesBishop(kingCol, kingRow), [this, otherBishop](const Move& move) {
-		char piece = GetPiece(move.to);
-		return (piece == otherBishop);
-	});
-	if (rookChecking or bishopChecking) return true;
-
-	char otherKnight = IsWhiteTurn() ? 'n' : 'N';
-	bool knightChecking = std::ranges::any_of(GetPseudoLegalMovesKnight(kingCol, kingRow), [this, otherKnight](const Move& move) {
-		char piece = GetPiece(move.to);
-		return (piece == otherKnight);
-	});
-	if (knightChecking) return true;
-
-	char otherKing = IsWhiteTurn() ? 'k' : 'K';
-	bool kingChecking = std::ranges::any_of(GetPseudoLegalMovesKing(kingCol, kingRow), [this, otherKing](const Move& move) {
-		char piece = GetPiece(move.to);
-		return (piece == otherKing);
-	});
-	if (kingChecking) return true;
-
-	// if the king is on the 2nd or 7th rank, it can't be checked by a pawn
-	if (IsWhiteTurn() and kingRow > 5 or
-		not IsWhiteTurn() and kingRow < 2)
-		return false;
+	return false;
+}
 
-	char otherPawn = IsWhiteTurn() ? 'p' : 'P';
-	bool pawnChecking = std::ranges::any_of(GetPseudoLegalMovesPawn(kingCol, kingRow), [this, otherPawn](const Move& move) {
-		char piece = GetPiece(move.to);
-		return (piece == otherPawn);
-	});
+template<Player By>
+std::vector<Coord> Board::GetAttackers(int index) const {
+	std::vector<Coord> attackers;
+	auto add = [&attackers](int square) {
+		attackers.emplace_back(AttackTables::Col(square), AttackTables::Row(square));
+	};
+
+	const AttackTables::Leaper& knights = AttackTables::KNIGHT[index];
+	for (int i = 0; i < knights.count; i++)
+		if (m_Board[knights.squares[i]] == PlayerPiece<By>('n'))
+			add(knights.squares[i]);
+
+	const AttackTables::Leaper& pawns = AttackTables::PAWN_ATTACKERS[static_cast<int>(By)][index];
+	for (int i = 0; i < pawns.count; i++)
+		if (m_Board[pawns.squares[i]] == PlayerPiece<By>('p'))
+			add(pawns.squares[i]);
+
+	const AttackTables::Leaper& kings = AttackTables::KING[index];
+	for (int i = 0; i < kings.count; i++)
+		if (m_Board[kings.squares[i]] == PlayerPiece<By>('k'))
+			add(kings.squares[i]);
+
+	for (int direction = 0; direction < AttackTables::DIRECTION_COUNT; direction++) {
+		const char slider = direction < 4 ? PlayerPiece<By>('r') : PlayerPiece<By>('b');
+		const AttackTables::Ray& ray = AttackTables::RAYS[index][direction];
+		for (int i = 0; i < ray.length; i++) {
+			char piece = m_Board[ray.squares[i]];
+			if (piece == ' ')
+				continue;
+			if (piece == slider or piece == PlayerPiece<By>('q'))
+				add(ray.squares[i]);
+			break;
+		}
+	}
 
-	return pawnChecking;
+	return attackers;
 }
 
-bool Board::IsGameOver() const {
-	return IsCheckmate() or IsDraw();
+std::string Board::GetFen() const {
+	char buffer[MAX_FEN_LENGTH];
+	return {buffer, WriteFen(buffer)};
 }
 
-std::string Board::GetFen() const {
-	std::string fen;
+size_t Board::WriteFen(char* buffer) const {
+	char* out = buffer;
 	int spaceCount = 0;
 	for (int i = 0; i < Board::SIZE * Board::SIZE; i++) {
 		char piece = m_Board[i];
 
 		if (piece != ' ') {
 			if (spaceCount) {
-				fen += std::to_string(spaceCount);
+				*out++ = (char)('0' + spaceCount);
 				spaceCount = 0;
 			}
-			fen += piece;
+			*out++ = piece;
 		} else
 			spaceCount++;
 
 		if (i % 8 == 7) {
 			if (spaceCount) {
-				fen += std::to_string(spaceCount);
+				*out++ = (char)('0' + spaceCount);
 				spaceCount = 0;
 			}
 			if (i < Board::SIZE * Board::SIZE - 1)
-				fen += '/';
+				*out++ = '/';
 		}
 	}
 
-	if (m_Playing == Player::White)
-		fen += " w";
-	else
-		fen += " b";
+	*out++ = ' ';
+	*out++ = m_Playing == Player::White ? 'w' : 'b';
 
-	fen += " ";
+	*out++ = ' ';
+	char* castling = out;
 	if (m_WhiteCastlingRights.first)
-		fen += "K";
+		*out++ = 'K';
 	if (m_WhiteCastlingRights.second)
-		fen += "Q";
+		*out++ = 'Q';
 	if (m_BlackCastlingRights.first)
-		fen += "k";
+		*out++ = 'k';
 	if (m_BlackCastlingRights.second)
-		fen += "q";
-	if (m_WhiteCastlingRights == std::pair(false, false) and
-		m_BlackCastlingRights == std::pair(false, false))
-		fen += "-";
-
-	if (m_EnPassant)
-		fen += " " + Coord2Chess(m_EnPassant.value());
-	else
-		fen += " -";
-
-	// deal w halfmove
-	fen += " " + std::to_string(m_halfMovesRule);
-
-	// deal with fullmove number
-	fen += " " + std::to_string(m_fullMoves);
-
-	return fen;
+		*out++ = 'q';
+	if (out == castling)
+		*out++ = '-';
+
+	*out++ = ' ';
+	if (m_EnPassant) {
+		*out++ = (char)('a' + m_EnPassant->first);
+		*out++ = (char)('1' + m_EnPassant->second);
+	} else
+		*out++ = '-';
+
+	// deal with the half move clock and the full move number
+	*out++ = ' ';
+	out = std::to_chars(out, buffer + MAX_FEN_LENGTH, m_halfMovesRule).ptr;
+	*out++ = ' ';
+	out = std::to_chars(out, buffer + MAX_FEN_LENGTH - 1, m_fullMoves).ptr;
+	*out = '\0';
+
+	return out - buffer;
 }
 
 void Board::UpdateCastlingRights(const Move& move) {
@@ -608,8 +841,9 @@ void Board::UpdateCastlingRights(const Move& move) {
 		else if (from == Coord({7, 7}))
 			m_BlackCastlingRights.first = false;
 	}
-		// if a rook is taken, castling is not allowed anymore
-	else if (pieceToReplace == 'R') {
+
+	// if a rook is taken, castling is not allowed anymore (even if it was taken by a rook)
+	if (pieceToReplace == 'R') {
 		if (to == Coord({0, 0}))
 			m_WhiteCastlingRights.second = false;
 		else if (to == Coord({7, 0}))
@@ -622,92 +856,14 @@ void Board::UpdateCastlingRights(const Move& move) {
 	}
 }
 
+template<Player P>
 bool Board::IsCastlingLegal(bool kingSide) const {
 	if (IsCheck())
 		return false;
 
 	// make sure the king doesn't castle through check
-	Board copy = *this;
-	if (kingSide) {
-		if (IsWhiteTurn())
-			copy.ApplyMove("e1f1");
-		else
-			copy.ApplyMove("e8f8");
-	}
-	else {
-		if (IsWhiteTurn())
-			copy.ApplyMove("e1d1");
-		else
-			copy.ApplyMove("e8d8");
-	}
-
-	copy.m_Playing = GetCurrentPlayer();
-	return not copy.IsCheck();
-}
-
-RawBoard Board::BoardFromFen(const std::string& fen) {
-	RawBoard board{};
-
-	int index = 0;
-	for (auto it = fen.begin(); *it != ' '; it++) {
-		if (*it == '/') continue;
-		if ('1' <= *it && *it <= '8')
-			for (int i = 0; i < *it - '0'; i++)
-				board[index++] = ' ';
-		else
-			board[index++] = *it;
-	}
-
-	return board;
-}
-
-std::optional<Coord> Board::ParseEnPassantFromFen(const std::string& fen) {
-	// if we split the fen by spaces, what index is the EP info
-	int indexInFen = 3;
-	// current in the split array
-	int index = 0;
-	// current index of char in string
-	int charIndex = 0;
-
-	while (index < indexInFen) {
-		if (fen[charIndex++] == ' ')
-			index++;
-	}
-
-	// if the fen has the info
-	if (fen[charIndex] != '-')
-		return Chess2Coord(&fen[charIndex]);
-
-	return {};
-}
-
-CastlingRights Board::ParseCastlingRightsFromFen(const std::string& fen, Player player) {
-	// if we split the fen by spaces, what index is the Castling info
-	int indexInFen = 2;
-	// current in the split array
-	int index = 0;
-	// current index of char in string
-	int charIndex = 0;
-
-	while (index < indexInFen) {
-		if (fen[charIndex++] == ' ')
-			index++;
-	}
-
-	CastlingRights cr{false, false};
-	// if there is no castling rights
-	if (fen[charIndex] == '-')
-		return cr;
-
-	// iterate over the castling rights
-	while (fen[charIndex] != ' ') {
-		if (fen[charIndex] == 'K' and player == Player::White ||
-			fen[charIndex] == 'k' and player == Player::Black)
-			cr.first = true;
-		else if (fen[charIndex] == 'Q' and player == Player::White ||
-				 fen[charIndex] == 'q' and player == Player::Black)
-			cr.second = true;
-		charIndex++;
-	}
-	return cr;
+	// the square it lands on is checked with the other moves when filtering the legal moves
+	constexpr int row = P == Player::White ? 0 : 7;
+	int col = kingSide ? 5 : 3;
+	return not IsSquareAttacked<Opponent<P>>(CoordToIndexInBoard(col, row));
 }
\ No newline at end of file
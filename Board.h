@@ -1,18 +1,32 @@
 #pragma once
 #include "Move.h"
 #include "Player.h"
+#include "AttackTables.h"
+#include "PackedPosition.h"
+#include "Zobrist.h"
+#include "BoardRepresentation.h"
 
 typedef std::array<char, 64> RawBoard;
 
+enum class GameStatus : uint8_t {
+	Ongoing, Checkmate, Stalemate, FiftyMoves
+};
+
 // holds all the information that the fen holds
 class Board {
 public:
-	explicit Board(const std::string& fen);
-	Board(const Board& other) = default;
+	explicit Board(std::string_view fen);
+	explicit Board(const PackedPosition& packed);
+	// copies only the position, the derived state is recomputed lazily by the copy
+	// since copies are almost always made to apply a move to them
+	Board(const Board& other);
+	Board& operator=(const Board& other);
 
 	void ApplyMove(const Move& move);
 	void ApplyMove(const Coord& from, const Coord& to) { return ApplyMove({from, to, std::nullopt}); }
 	void ApplyMove(const std::string& notation) { return ApplyMove(Chess2Move(notation)); }
+	// passes the turn without moving, used by the search for null move pruning
+	void ApplyNullMove();
 
 	char& GetPieceRef(const Coord& coord) { return GetPieceRef(coord.first, coord.second); }
 	char& GetPieceRef(int col, int row) { return m_Board[CoordToIndexInBoard(col, row)]; }
@@ -26,23 +40,50 @@ public:
 		return IsWhiteTurn() ? Player::Black : Player::White;
 	}
 
-	[[nodiscard]] bool IsCheckmate() const;
+	[[nodiscard]] bool IsCheckmate() const { return GetStatus() == GameStatus::Checkmate; }
 	[[nodiscard]] bool IsCheck() const;
-	[[nodiscard]] bool IsDraw() const;
-	[[nodiscard]] bool IsGameOver() const;
+	[[nodiscard]] bool IsDraw() const {
+		return GetStatus() == GameStatus::Stalemate or GetStatus() == GameStatus::FiftyMoves;
+	}
+	[[nodiscard]] bool IsGameOver() const { return GetStatus() != GameStatus::Ongoing; }
+	[[nodiscard]] GameStatus GetStatus() const;
+	// squares of the opponent's pieces giving check to the current player
+	[[nodiscard]] const std::vector<Coord>& GetCheckers() const;
+	// does any piece of the player attack the square, no move is generated to answer this
+	[[nodiscard]] bool IsSquareAttacked(const Coord& square, Player by) const {
+		return IsSquareAttacked(CoordToIndexInBoard(square.first, square.second), by);
+	}
+	[[nodiscard]] bool IsSquareAttacked(int index, Player by) const;
+	[[nodiscard]] Coord GetKingSquare(Player player) const {
+		int index = m_KingIndex[static_cast<int>(player)];
+		return {AttackTables::Col(index), AttackTables::Row(index)};
+	}
+	// does the move take a piece, en passant included
+	[[nodiscard]] bool IsCapture(const Move& move) const;
+	// material won by the side to move in centipawns when the exchange the move starts on its target square is played out
+	// each side takes back with its least valuable piece or stops when that would lose more, x-rays included
+	[[nodiscard]] int StaticExchange(const Move& move) const;
+	// does the player have anything besides the king and pawns, those positions are the zugzwang prone ones
+	[[nodiscard]] bool HasNonPawnMaterial(Player player) const;
 	[[nodiscard]] std::vector<Move> GetPseudoLegalMoves() const;
 	[[nodiscard]] const std::vector<Move>& GetLegalMoves() const;
 
 	[[nodiscard]] std::string GetFen() const;
+	// writes the fen and a terminating null into a buffer of at least MAX_FEN_LENGTH chars
+	// returns the length of the fen, nothing is allocated
+	size_t WriteFen(char* buffer) const;
+	static constexpr size_t MAX_FEN_LENGTH = 128;
+
+	[[nodiscard]] PackedPosition Pack() const;
+	// zobrist hash of the position, the clocks are not part of it
+	[[nodiscard]] uint64_t GetHash() const;
 
 	[[nodiscard]] char operator[](size_t index) const {return m_Board[index]; }
+	[[nodiscard]] const RawBoard& GetRawBoard() const { return m_Board; }
+	// the occupied squares as a mask of RawBoard indices
+	[[nodiscard]] static uint64_t GetOccupancy(const RawBoard& board);
 	friend std::ostream& operator<<(std::ostream& ostream, const Board& board);
 	static constexpr int SIZE = 8;
-	[[nodiscard]] static unsigned long GetCacheHits() { return s_LegalMovesCacheHits;}
-	[[nodiscard]] static unsigned long GetCacheMisses() { return s_LegalMovesCacheMisses;}
-	[[nodiscard]] static double GetCacheHitRate() {
-		return static_cast<double>(s_LegalMovesCacheHits) / static_cast<double>(s_LegalMovesCacheHits + s_LegalMovesCacheMisses);
-	}
 private:
 	constexpr static int CoordToIndexInBoard(int col, int row) {
 		if (col < 0 or col > SIZE - 1 or row < 0 or row > SIZE - 1) {
@@ -53,37 +94,49 @@ private:
 		return col + SIZE * (SIZE - row - 1);
 	}
 
-	[[nodiscard]] static RawBoard BoardFromFen(const std::string& fen);
-	[[nodiscard]] static std::optional<Coord> ParseEnPassantFromFen(const std::string& fen);
-	[[nodiscard]] static CastlingRights ParseCastlingRightsFromFen(const std::string& fen, Player player);
-	[[nodiscard]] std::string GetPositionalFen() const {
-		std::string fen = GetFen();
-		// remove the last two fields
-		fen = fen.substr(0, fen.find_last_of(' '));
-		fen = fen.substr(0, fen.find_last_of(' '));
-		return fen;
-	}
+	void ParseFen(std::string_view fen);
 
-	[[nodiscard]] static inline bool IsPlayerPiece(char piece, Player player) {
-		return (player == Player::White and std::isupper(piece))
-			   or (player == Player::Black and std::islower(piece));
+	// everything that depends on the side is resolved at compile time, each side gets its own straight line code
+	template<Player P>
+	[[nodiscard]] static constexpr bool IsPlayerPiece(char piece) {
+		if constexpr (P == Player::White)
+			return 'A' <= piece and piece <= 'Z';
+		else
+			return 'a' <= piece and piece <= 'z';
+	}
+	// the piece of the player from its lowercase letter
+	template<Player P>
+	[[nodiscard]] static constexpr char PlayerPiece(char type) {
+		if constexpr (P == Player::White)
+			return (char)(type - 'a' + 'A');
+		else
+			return type;
 	}
-	[[nodiscard]] std::vector<Move> GetLegalMovesForPiece(int col, int row) const;
-	[[nodiscard]] std::vector<Move> GetPseudoLegalMovesRook(int col, int row) const;
-	[[nodiscard]] std::vector<Move> GetPseudoLegalMovesKnight(int col, int row) const;
-	[[nodiscard]] std::vector<Move> GetPseudoLegalMovesBishop(int col, int row) const;
-	[[nodiscard]] std::vector<Move> GetPseudoLegalMovesQueen(int col, int row) const;
-	[[nodiscard]] std::vector<Move> GetPseudoLegalMovesKing(int col, int row) const;
-	[[nodiscard]] std::vector<Move> GetPseudoLegalMovesPawn(int col, int row) const;
+	template<Player P>
+	static constexpr Player Opponent = P == Player::White ? Player::Black : Player::White;
+
+	// the moves are appended to the vector, in the order the pieces and their moves are found
+	template<Player P> void GeneratePseudoLegalMoves(std::vector<Move>& moves) const;
+	template<Player P> void GenerateMovesForPiece(int col, int row, std::vector<Move>& moves) const;
+	template<Player P> void GenerateRookMoves(int col, int row, std::vector<Move>& moves) const;
+	template<Player P> void GenerateKnightMoves(int col, int row, std::vector<Move>& moves) const;
+	template<Player P> void GenerateBishopMoves(int col, int row, std::vector<Move>& moves) const;
+	template<Player P> void GenerateKingMoves(int col, int row, std::vector<Move>& moves) const;
+	template<Player P> void GeneratePawnMoves(int col, int row, std::vector<Move>& moves) const;
+	// removes the moves that leave the king of the player in check
+	template<Player P> void RemoveIllegalMoves(std::vector<Move>& moves) const;
 
+	template<Player By> [[nodiscard]] bool IsSquareAttacked(int index) const;
+	template<Player By> [[nodiscard]] std::vector<Coord> GetAttackers(int index) const;
+	// the pieces of both sides attacking the square as a mask of RawBoard indices
+	// only the pieces in occupied are there and only they block the sliders
+	[[nodiscard]] uint64_t GetAttackersTo(int index, uint64_t occupied) const;
+	template<Player P> [[nodiscard]] bool HasNonPawnMaterial() const;
+	template<Player P> [[nodiscard]] bool IsCastlingLegal(bool kingSide) const;
 	void UpdateCastlingRights(const Move& move);
-	[[nodiscard]] bool IsCastlingLegal(bool kingSide) const;
 
-	// Legal moves cache
-	static unsigned long s_LegalMovesCacheHits;
-	static unsigned long s_LegalMovesCacheMisses;
-	static std::shared_timed_mutex s_CacheMutex;
-	static std::unordered_map<std::string, std::vector<Move>> s_FenToLegalMovesCache;
+	// forget everything derived from the position, called whenever the position changes
+	void InvalidateDerivedState();
 
 	RawBoard m_Board;
 	std::optional<Coord> m_EnPassant;
@@ -95,4 +148,16 @@ private:
 	Player m_Playing = Player::White;
 	int m_halfMovesRule = 0;
 	int m_fullMoves = 1;
-};
\ No newline at end of file
+
+	// where the kings are, indexed by Player, -1 if there is none on the board
+	std::array<int, 2> m_KingIndex{-1, -1};
+
+	// derived state, computed at most once per position
+	mutable std::optional<std::vector<Move>> m_LegalMoves;
+	mutable std::optional<std::vector<Coord>> m_Checkers;
+	mutable std::optional<bool> m_IsCheck;
+	mutable std::optional<GameStatus> m_Status;
+	mutable std::optional<uint64_t> m_Hash;
+};
+
+static_assert(BoardRepresentation<Board>);
@@ -105,24 +105,6 @@ BoardOptimized::BoardOptimized(const std::string& fen) {
 	}
 }
 
-BitBoard BoardOptimized::PawnAttacks(Player player) const {
-	if (player == Player::White)
-		return (m_WhitePawns & ~s_FILE_H) << 7 | (m_WhitePawns & ~s_FILE_A) << 9;
-	else
-		return (m_BlackPawns & ~s_FILE_A) >> 7 | (m_BlackPawns & ~s_FILE_H) >> 9;
-}
-
-BitBoard BoardOptimized::KnightAttacks(Player player) const {
-	BitBoard knights = player == Player::White ? m_WhiteKnights : m_BlackKnights;
-	BitBoard l1 = (knights >> 1) & ~s_FILE_A;
-	BitBoard l2 = (knights >> 2) & ~(s_FILE_A | s_FILE_B);
-	BitBoard r1 = (knights << 1) & ~s_FILE_H;
-	BitBoard r2 = (knights << 2) & ~(s_FILE_G | s_FILE_H);
-	BitBoard h1 = l1 | r1;
-	BitBoard h2 = l2 | r2;
-	return (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
-}
-
 BitBoard BoardOptimized::BishopAttacks(BitBoard occ, enumSquare sq) const {
 	BitBoard* attackTablePtr = m_BishopTable[sq].attack_table_ptr;
 	occ      &= m_BishopTable[sq].mask;
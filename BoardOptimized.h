@@ -2,6 +2,8 @@
 #include "Player.h"
 
 // this board uses bit boards to store the pieces
+// it doesn't generate moves yet so it isn't a BoardRepresentation, once it is it only has to be added
+// to the explicit instantiations of the engine, the game and the evaluation
 typedef uint64_t BitBoard;
 
 struct SMagic {
@@ -65,8 +67,10 @@ public:
 		std::cout << '\n';
 	}
 private:
-	[[nodiscard]] BitBoard PawnAttacks(Player player) const;
-	[[nodiscard]] BitBoard KnightAttacks(Player player) const;
+	template<Player P>
+	[[nodiscard]] BitBoard PawnAttacks() const;
+	template<Player P>
+	[[nodiscard]] BitBoard KnightAttacks() const;
 
 	[[nodiscard]] BitBoard BishopAttacks(BitBoard occ, enumSquare sq) const;
 	[[nodiscard]] BitBoard RookAttacks(BitBoard occ, enumSquare sq) const;
@@ -105,4 +109,24 @@ private:
 
 	SMagic m_BishopTable[64]{};
 	SMagic m_RookTable[64]{};
-};
\ No newline at end of file
+};
+
+template<Player P>
+BitBoard BoardOptimized::PawnAttacks() const {
+	if constexpr (P == Player::White)
+		return (m_WhitePawns & ~s_FILE_H) << 7 | (m_WhitePawns & ~s_FILE_A) << 9;
+	else
+		return (m_BlackPawns & ~s_FILE_A) >> 7 | (m_BlackPawns & ~s_FILE_H) >> 9;
+}
+
+template<Player P>
+BitBoard BoardOptimized::KnightAttacks() const {
+	BitBoard knights = P == Player::White ? m_WhiteKnights : m_BlackKnights;
+	BitBoard l1 = (knights >> 1) & ~s_FILE_A;
+	BitBoard l2 = (knights >> 2) & ~(s_FILE_A | s_FILE_B);
+	BitBoard r1 = (knights << 1) & ~s_FILE_H;
+	BitBoard r2 = (knights << 2) & ~(s_FILE_G | s_FILE_H);
+	BitBoard h1 = l1 | r1;
+	BitBoard h2 = l2 | r2;
+	return (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include <concepts>
+#include "Move.h"
+#include "Player.h"
+#include "PackedPosition.h"
+
+// what the engine and the game need from a board, so a representation can be swapped without virtual calls
+// a move is taken back by keeping the board from before it, so copies have to be cheap
+// squares are indexed like the RawBoard: a8 = 0, h8 = 7, ..., a1 = 56, h1 = 63
+template<typename B>
+concept BoardRepresentation = std::copyable<B> and std::constructible_from<B, std::string_view> and
+	requires(B board, const B& constBoard, const Move& move, const Coord& coord, Player player, std::ostream& ostream) {
+		{ B::SIZE } -> std::convertible_to<int>;
+
+		board.ApplyMove(move);
+		board.ApplyNullMove();
+		{ constBoard.GetLegalMoves() } -> std::same_as<const std::vector<Move>&>;
+
+		{ constBoard.IsWhiteTurn() } -> std::same_as<bool>;
+		{ constBoard.GetCurrentPlayer() } -> std::same_as<Player>;
+		{ constBoard.GetFullMoves() } -> std::same_as<int>;
+		{ constBoard.IsCheck() } -> std::same_as<bool>;
+		{ constBoard.IsDraw() } -> std::same_as<bool>;
+		{ constBoard.IsGameOver() } -> std::same_as<bool>;
+		{ constBoard.IsCapture(move) } -> std::same_as<bool>;
+		{ constBoard.StaticExchange(move) } -> std::same_as<int>;
+		{ constBoard.HasNonPawnMaterial(player) } -> std::same_as<bool>;
+
+		// the piece letter on a square, ' ' if it is empty
+		{ constBoard.GetPiece(coord) } -> std::same_as<char>;
+		{ constBoard[size_t{}] } -> std::same_as<char>;
+
+		{ constBoard.GetHash() } -> std::same_as<uint64_t>;
+		{ constBoard.GetFen() } -> std::same_as<std::string>;
+		{ constBoard.Pack() } -> std::same_as<PackedPosition>;
+		ostream << constBoard;
+	};
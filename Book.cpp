@@ -0,0 +1,270 @@
+#include "pch.h"
+#include "Book.h"
+#include "Pgn.h"
+#include "ThreadPool.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace Book {
+	namespace {
+		// the shard is the top bits of the key, so the shards in order are the keys in order
+		constexpr int SHARD_BITS = 6;
+		constexpr size_t SHARD_COUNT = 1 << SHARD_BITS;
+		// the moves of a chunk are buffered and added to the shards in batches, one lock per shard and batch
+		constexpr size_t FLUSH_SIZE = 1 << 16;
+
+		constexpr char FILE_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'B', 'K', '\0'};
+		// bumped whenever the entries or the way they are keyed change
+		constexpr uint32_t FILE_VERSION = 1;
+
+		struct FileHeader {
+			char magic[8];
+			uint32_t version;
+			uint32_t entrySize;
+			// a book keyed with other keys only has collisions
+			uint64_t keys;
+		};
+		static_assert(sizeof(FileHeader) <= Reader::HEADER_SIZE);
+
+		// a move played in a game, the outcome for the side playing it: 1 won, 0 drawn, -1 lost
+		struct Sample {
+			uint64_t key;
+			uint16_t move;
+			int8_t outcome;
+		};
+
+		struct Counts {
+			uint64_t key = 0;
+			uint16_t move = 0;
+			// wins, draws and losses
+			std::array<uint32_t, 3> games{};
+
+			[[nodiscard]] uint32_t GetGames() const { return games[0] + games[1] + games[2]; }
+			[[nodiscard]] uint64_t GetScore() const { return 2 * (uint64_t)games[0] + games[1]; }
+		};
+
+		struct Shard {
+			std::mutex mutex;
+			// keyed by the position and the move together
+			std::unordered_map<uint64_t, Counts> moves;
+		};
+
+		size_t ShardOf(uint64_t key) {
+			return key >> (64 - SHARD_BITS);
+		}
+
+		uint64_t MoveKey(uint64_t key, uint16_t move) {
+			return key ^ (move + 1ULL) * 0x9e3779b97f4a7c15ULL;
+		}
+
+		void Flush(std::vector<Shard>& shards, std::vector<Sample>& samples) {
+			std::ranges::sort(samples, {}, [](const Sample& sample) { return ShardOf(sample.key); });
+			for (auto begin = samples.begin(); begin != samples.end();) {
+				size_t shardIndex = ShardOf(begin->key);
+				auto end = std::find_if(begin, samples.end(), [shardIndex](const Sample& sample) { return ShardOf(sample.key) != shardIndex; });
+				Shard& shard = shards[shardIndex];
+				std::lock_guard lock(shard.mutex);
+				for (; begin != end; ++begin) {
+					Counts& counts = shard.moves.try_emplace(MoveKey(begin->key, begin->move), Counts{begin->key, begin->move}).first->second;
+					counts.games[1 - begin->outcome]++;
+				}
+			}
+			samples.clear();
+		}
+
+		void WriteBigEndian(char* out, uint64_t value, int bytes) {
+			for (int i = bytes - 1; i >= 0; i--, value >>= 8)
+				out[i] = (char)(value & 0xff);
+		}
+
+		uint64_t ReadBigEndian(const char* in, int bytes) {
+			uint64_t value = 0;
+			for (int i = 0; i < bytes; i++)
+				value = value << 8 | (uint8_t)in[i];
+			return value;
+		}
+
+		// the entries of a shard that pass the filter, sorted by key and then by weight
+		std::vector<char> WriteShard(const Shard& shard, const BuildOptions& options) {
+			std::vector<Counts> moves;
+			for (const auto& [moveKey, counts] : shard.moves)
+				if (counts.GetGames() >= options.minGames and counts.GetScore() > 0)
+					moves.push_back(counts);
+			std::ranges::sort(moves, [](const Counts& lhs, const Counts& rhs) {
+				return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.GetScore() > rhs.GetScore();
+			});
+
+			std::vector<char> entries(moves.size() * Reader::ENTRY_SIZE);
+			for (size_t first = 0; first < moves.size();) {
+				// the heaviest move of the position is first, the others are scaled down with it to fit in 16 bits
+				uint64_t divisor = moves[first].GetScore() / 0xffff + 1;
+				size_t i = first;
+				for (; i < moves.size() and moves[i].key == moves[first].key; i++) {
+					char* entry = entries.data() + i * Reader::ENTRY_SIZE;
+					WriteBigEndian(entry, moves[i].key, 8);
+					WriteBigEndian(entry + 8, moves[i].move, 2);
+					WriteBigEndian(entry + 10, std::max<uint64_t>(moves[i].GetScore() / divisor, 1), 2);
+					WriteBigEndian(entry + 12, 0, 4);
+				}
+				first = i;
+			}
+			return entries;
+		}
+	}
+
+	template<BoardRepresentation B>
+	uint16_t EncodeMove(const B& board, const Move& move) {
+		int toFile = move.to.first;
+		if ((board.GetPiece(move.from) | 0x20) == 'k' and std::abs(move.to.first - move.from.first) == 2)
+			toFile = move.to.first > move.from.first ? B::SIZE - 1 : 0;
+		int promote = move.promote ? (int)std::string_view(" nbrq").find((char)(move.promote.value() | 0x20)) : 0;
+		return (uint16_t)(toFile | move.to.second << 3 | move.from.first << 6 | move.from.second << 9 | promote << 12);
+	}
+
+	BuildStats Build(const std::string& pgnPath, const std::string& bookPath, const BuildOptions& options, ThreadPool* pool) {
+		BuildStats stats;
+		std::vector<Shard> shards(SHARD_COUNT);
+		size_t chunks = pool ? pool->GetThreadCount() * 4 : 1;
+		std::vector<std::vector<Sample>> pending(chunks);
+		std::atomic<uint64_t> unfinished = 0;
+
+		Pgn::ReadStats readStats = Pgn::ReadFile(pgnPath, chunks, [&](const Pgn::Game& game, size_t chunk) {
+			int8_t whiteOutcome;
+			if (game.result == "1-0")
+				whiteOutcome = 1;
+			else if (game.result == "0-1")
+				whiteOutcome = -1;
+			else if (game.result == "1/2-1/2")
+				whiteOutcome = 0;
+			else {
+				unfinished.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			// replayed on the engine's board, so the keys are the ones it probes with
+			Board board(game.startFen);
+			std::vector<Sample>& samples = pending[chunk];
+			for (size_t ply = 0; ply < game.moves.size(); ply++) {
+				const Move& move = game.moves[ply];
+				samples.push_back({board.GetHash(), EncodeMove(board, move), (int8_t)(board.IsWhiteTurn() ? whiteOutcome : -whiteOutcome)});
+				board.ApplyMove(move);
+			}
+			if (samples.size() >= FLUSH_SIZE)
+				Flush(shards, samples);
+		}, pool, (size_t)options.maxPly);
+		for (std::vector<Sample>& samples : pending)
+			Flush(shards, samples);
+		stats.games = readStats.games - unfinished;
+		stats.skipped = readStats.errors + unfinished;
+		stats.readMs = readStats.timeMs;
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::vector<char>> entries(SHARD_COUNT);
+		std::optional<ThreadPool::Batch> batch;
+		if (pool)
+			batch.emplace(*pool);
+		for (size_t shard = 0; shard < SHARD_COUNT; shard++) {
+			stats.counted += shards[shard].moves.size();
+			auto write = [&, shard] {
+				entries[shard] = WriteShard(shards[shard], options);
+				// the counts aren't needed anymore, the next shards get their memory
+				shards[shard].moves = {};
+			};
+			if (batch)
+				batch->Submit(write);
+			else
+				write();
+		}
+		if (batch)
+			batch->Wait();
+
+		// written next to the book and renamed over it, so a reader never maps half a file
+		std::string temporary = bookPath + ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			FileHeader header{};
+			std::ranges::copy(FILE_MAGIC, header.magic);
+			header.version = FILE_VERSION;
+			header.entrySize = Reader::ENTRY_SIZE;
+			header.keys = Zobrist::Fingerprint();
+			std::array<char, Reader::HEADER_SIZE> block{};
+			std::memcpy(block.data(), &header, sizeof(header));
+			file.write(block.data(), (std::streamsize)block.size());
+			for (const std::vector<char>& shard : entries) {
+				file.write(shard.data(), (std::streamsize)shard.size());
+				stats.entries += shard.size() / Reader::ENTRY_SIZE;
+			}
+			if (not file)
+				throw std::runtime_error("could not write " + temporary);
+		}
+		std::filesystem::rename(temporary, bookPath);
+		stats.writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+
+	Reader::Reader(const std::string& path)
+		: m_File(path, Memory::Access::Random) {
+		FileHeader header{};
+		if (m_File.GetSize() >= HEADER_SIZE)
+			std::memcpy(&header, m_File.GetData(), sizeof(header));
+		if (m_File.GetSize() < HEADER_SIZE or not std::ranges::equal(header.magic, FILE_MAGIC) or header.entrySize != ENTRY_SIZE or
+			(m_File.GetSize() - HEADER_SIZE) % ENTRY_SIZE != 0)
+			throw std::runtime_error(path + " is not a book");
+		if (header.version != FILE_VERSION or header.keys != Zobrist::Fingerprint())
+			throw std::runtime_error(path + " is a book of another version of the engine");
+	}
+
+	template<BoardRepresentation B>
+	std::vector<BookMove> Reader::GetMoves(const B& board) const {
+		const uint64_t key = board.GetHash();
+		const char* data = GetEntries();
+		const size_t count = GetEntryCount();
+
+		// the first entry of the key
+		size_t low = 0, high = count;
+		while (low < high) {
+			size_t middle = (low + high) / 2;
+			if (ReadBigEndian(data + middle * ENTRY_SIZE, 8) < key)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+
+		std::vector<BookMove> moves;
+		for (size_t i = low; i < count and ReadBigEndian(data + i * ENTRY_SIZE, 8) == key; i++) {
+			const char* entry = data + i * ENTRY_SIZE;
+			auto code = (uint16_t)ReadBigEndian(entry + 8, 2);
+			// a move that isn't legal here is a key collision
+			for (const Move& move : board.GetLegalMoves())
+				if (EncodeMove(board, move) == code) {
+					moves.push_back({move, (uint16_t)ReadBigEndian(entry + 10, 2)});
+					break;
+				}
+		}
+		std::ranges::stable_sort(moves, std::greater{}, &BookMove::weight);
+		return moves;
+	}
+
+	template<BoardRepresentation B>
+	std::optional<Move> Reader::PickMove(const B& board, uint64_t random) const {
+		std::vector<BookMove> moves = GetMoves(board);
+		uint64_t total = 0;
+		for (const BookMove& move : moves)
+			total += move.weight;
+		if (total == 0)
+			return std::nullopt;
+		random %= total;
+		for (const BookMove& move : moves) {
+			if (random < move.weight)
+				return move.move;
+			random -= move.weight;
+		}
+		return std::nullopt;
+	}
+
+	// the board representations the book is built for
+	template uint16_t EncodeMove(const Board& board, const Move& move);
+	template std::vector<BookMove> Reader::GetMoves(const Board& board) const;
+	template std::optional<Move> Reader::PickMove(const Board& board, uint64_t random) const;
+}
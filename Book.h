@@ -0,0 +1,64 @@
+#pragma once
+#include "Board.h"
+#include "Memory.h"
+
+class ThreadPool;
+
+// opening books in a file of the engine's own: a header, then 16 byte big endian entries sorted by key, key, move, weight and learn
+// the keys are Board::GetHash, so a book is built from pgn by the engine it is read by, the header tells the keys it was built with
+namespace Book {
+	struct BuildOptions {
+		// a move is only kept if it was played in at least this many games from the position
+		uint32_t minGames = 3;
+		// the positions after this many plies of a game are not counted
+		int maxPly = 20;
+	};
+
+	struct BuildStats {
+		uint64_t games = 0;
+		// games without a result or with a move that can't be read
+		uint64_t skipped = 0;
+		// distinct positions and moves counted, and the moves written after the filter
+		uint64_t counted = 0;
+		uint64_t entries = 0;
+		double readMs = 0;
+		double writeMs = 0;
+	};
+
+	// the games are counted in parallel on the pool, into a map sharded by the key so the threads rarely wait for each other
+	// a move weighs twice its wins and once its draws for the side playing it, the moves that never scored are left out
+	BuildStats Build(const std::string& pgnPath, const std::string& bookPath, const BuildOptions& options, ThreadPool* pool = nullptr);
+
+	// the move in 16 bits, to, from and the promotion, castling as the king taking its own rook
+	template<BoardRepresentation B>
+	[[nodiscard]] uint16_t EncodeMove(const B& board, const Move& move);
+
+	struct BookMove {
+		Move move;
+		uint16_t weight = 0;
+	};
+
+	// a book mapped read only, lookups only touch the pages of their binary search
+	class Reader {
+	public:
+		// throws std::runtime_error if the file can't be mapped, isn't a book or is one built with other keys
+		explicit Reader(const std::string& path);
+
+		[[nodiscard]] size_t GetEntryCount() const { return (m_File.GetSize() - HEADER_SIZE) / ENTRY_SIZE; }
+
+		// the legal moves the book has for the position, heaviest first
+		template<BoardRepresentation B>
+		[[nodiscard]] std::vector<BookMove> GetMoves(const B& board) const;
+		// one of the moves, picked with a chance proportional to its weight, random is any uniformly random number
+		template<BoardRepresentation B>
+		[[nodiscard]] std::optional<Move> PickMove(const B& board, uint64_t random) const;
+
+		static constexpr size_t ENTRY_SIZE = 16;
+		// two entries, so the entries after it stay aligned in the mapping
+		static constexpr size_t HEADER_SIZE = 2 * ENTRY_SIZE;
+	private:
+		[[nodiscard]] const char* GetEntries() const { return m_File.GetData() + HEADER_SIZE; }
+
+		Memory::MappedFile m_File;
+	};
+}
@@ -1,34 +1,45 @@
 #include "pch.h"
 #include "Chess.h"
 
-Chess::Chess(const std::string& fen)
-	: m_Board(fen)
+template<BoardRepresentation B>
+BasicChess<B>::BasicChess(const std::string& fen)
+	: m_StartFen(fen), m_Board(fen)
 {}
 
-std::ostream& operator<<(std::ostream& ostream, const Chess& chess) {
-	ostream << chess.m_Board.GetFen() << std::endl;
-	ostream << chess.m_Board << std::endl;
-
-	return ostream;
-}
-
-std::string Chess::TrimFen(const std::string& fen) {
-	size_t indexOfSpace = fen.find(' ');
-	std::string trimmedFen = fen.substr(0, indexOfSpace);
-	return trimmedFen;
-}
-
-bool Chess::IsGameOver() const {
+template<BoardRepresentation B>
+bool BasicChess<B>::IsGameOver() const {
 	if (m_Board.IsGameOver())
 		return true;
-	std::string fen = TrimFen(m_Board.GetFen());
-	// if the fen appears three times it is a draw
-	if (std::count(m_ReachedFens.begin(), m_ReachedFens.end(), fen) >= 3)
+	PackedPosition position = m_Board.Pack();
+	// if the position appears three times it is a draw
+	if (std::ranges::count_if(m_ReachedPositions, [&position](const PackedPosition& reached) {
+		return reached.SamePosition(position);
+	}) >= 3)
 		return true;
 	return false;
 }
 
-Chess& Chess::ApplyMove(const Move& move) {
+template<BoardRepresentation B>
+std::string BasicChess<B>::GetResult() const {
+	if (not IsGameOver())
+		return "*";
+	// checkmate, the side to move lost
+	if (m_Board.IsGameOver() and not m_Board.IsDraw())
+		return m_Board.IsWhiteTurn() ? "0-1" : "1-0";
+	return "1/2-1/2";
+}
+
+template<BoardRepresentation B>
+Pgn::Game BasicChess<B>::GetGame() const {
+	Pgn::Game game;
+	game.startFen = m_StartFen;
+	game.moves = m_Moves;
+	game.result = GetResult();
+	return game;
+}
+
+template<BoardRepresentation B>
+BasicChess<B>& BasicChess<B>::ApplyMove(const Move& move) {
 	if (not IsMoveLegal(move)) {
 		std::cout << "Move is not legal!" << std::endl;
 		std::cout << move << std::endl;
@@ -37,24 +48,27 @@ Chess& Chess::ApplyMove(const Move& move) {
 	std::stringstream ss;
 	if (m_Board.IsWhiteTurn())
 		ss << m_Board.GetFullMoves() << ". ";
-
-	m_Board.ApplyMove(move);
-
-	ss << move.from << move.to;
-	if (move.promote)
-		ss << "=" << move.promote.value();
-	ss << " ";
+	else if (m_Moves.empty())
+		ss << m_Board.GetFullMoves() << "... ";
+	// the san depends on the position before the move
+	ss << Pgn::MoveToSan(m_Board, move) << " ";
 	m_PGN += ss.str();
 
-	m_ReachedFens.push_back(TrimFen(m_Board.GetFen()));
+	// the move can be one of the legal moves of the board, which applying it clears
+	m_Moves.push_back(move);
+	m_Board.ApplyMove(m_Moves.back());
+
+	m_ReachedPositions.push_back(m_Board.Pack());
 	return *this;
 }
 
-const std::vector<Move>& Chess::GetLegalMoves() const {
+template<BoardRepresentation B>
+const std::vector<Move>& BasicChess<B>::GetLegalMoves() const {
 	return m_Board.GetLegalMoves();
 }
 
-bool Chess::IsMoveLegal(const Move& move) const {
+template<BoardRepresentation B>
+bool BasicChess<B>::IsMoveLegal(const Move& move) const {
 	return std::ranges::any_of(m_Board.GetLegalMoves(), [move](const Move& legalMove) {
 		return legalMove == move;
 	});
@@ -74,7 +88,11 @@ static Iter select_randomly(Iter start, Iter end) {
 	return select_randomly(start, end, gen);
 }
 
-Move Chess::GetRandomLegalMove() const {
+template<BoardRepresentation B>
+Move BasicChess<B>::GetRandomLegalMove() const {
 	const auto& moves = GetLegalMoves();
 	return *select_randomly(moves.begin(), moves.end());
-}
\ No newline at end of file
+}
+
+// the board representations the game is built for
+template class BasicChess<Board>;
@@ -1,31 +1,47 @@
 #pragma once
 #include "Board.h"
 #include "Player.h"
+#include "Pgn.h"
 
-class Chess {
+// a game on any board representation
+template<BoardRepresentation B>
+class BasicChess {
 public:
-	explicit Chess(const std::string& fen
-		= std::string("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+	explicit BasicChess(const std::string& fen
+		= std::string(Pgn::START_FEN));
 
+	// the movetext in san
 	[[nodiscard]] const std::string& GetPGN() const { return m_PGN; }
-	[[nodiscard]] const Board& GetBoard() const {return m_Board; }
+	// the moves so far with the start position and the result, to write with Pgn::Write
+	[[nodiscard]] Pgn::Game GetGame() const;
+	[[nodiscard]] const B& GetBoard() const {return m_Board; }
 
-	Chess& ApplyMove(const Move& move);
-	Chess& ApplyMove(const Coord& from, const Coord& to) { return ApplyMove({from, to, std::nullopt}); }
-	Chess& ApplyMove(const std::string& notation) { return ApplyMove(Chess2Move(notation)); }
+	BasicChess& ApplyMove(const Move& move);
+	BasicChess& ApplyMove(const Coord& from, const Coord& to) { return ApplyMove({from, to, std::nullopt}); }
+	BasicChess& ApplyMove(const std::string& notation) { return ApplyMove(Chess2Move(notation)); }
 
 	[[nodiscard]] bool IsGameOver() const;
+	// "1-0", "0-1", "1/2-1/2" or "*" while the game goes on
+	[[nodiscard]] std::string GetResult() const;
 
 	[[nodiscard]] const std::vector<Move>& GetLegalMoves() const;
 	[[nodiscard]] Move GetRandomLegalMove() const;
 
-	friend std::ostream& operator<<(std::ostream& ostream, const Chess& chess);
+	friend std::ostream& operator<<(std::ostream& ostream, const BasicChess& chess) {
+		ostream << chess.m_Board.GetFen() << std::endl;
+		ostream << chess.m_Board << std::endl;
+
+		return ostream;
+	}
 private:
 	[[nodiscard]] bool IsMoveLegal(const Move& move) const;
-	[[nodiscard]] static std::string TrimFen(const std::string& fen) ;
 
 	std::string m_PGN;
-	Board m_Board;
+	std::string m_StartFen;
+	std::vector<Move> m_Moves;
+	B m_Board;
+
+	std::vector<PackedPosition> m_ReachedPositions;
+};
 
-	std::vector<std::string> m_ReachedFens;
-};
\ No newline at end of file
+typedef BasicChess<Board> Chess;
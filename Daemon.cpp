@@ -0,0 +1,470 @@
+#include "pch.h"
+#include "Daemon.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+	// a client sending a longer line without a newline is dropped
+	constexpr size_t MAX_LINE_LENGTH = 64 * 1024;
+	// how often the deadline of a depth search is enforced again, in case the first stop came before the search started
+	constexpr auto STOP_REPEAT = std::chrono::milliseconds(10);
+
+	// the write end of the wake pipe of the running daemon, the only thing a signal handler may touch
+	std::atomic<int> s_SignalWakeFd = -1;
+
+	void OnSignal(int) {
+		int fd = s_SignalWakeFd.load(std::memory_order_relaxed);
+		char wake = 's';
+		if (fd >= 0)
+			(void)!write(fd, &wake, 1);
+	}
+
+	// the fields of a flat json object, the strings unescaped and everything else as it is written
+	std::optional<std::unordered_map<std::string, std::string>> ParseObject(std::string_view text) {
+		std::unordered_map<std::string, std::string> fields;
+		size_t i = 0;
+		auto skipSpaces = [&] {
+			while (i < text.size() and std::isspace((unsigned char)text[i]))
+				i++;
+		};
+		auto parseString = [&](std::string& out) {
+			if (i >= text.size() or text[i] != '"')
+				return false;
+			for (i++; i < text.size(); i++) {
+				char c = text[i];
+				if (c == '"') {
+					i++;
+					return true;
+				}
+				if (c == '\\' and ++i < text.size()) {
+					switch (text[i]) {
+						case 'n': c = '\n'; break;
+						case 't': c = '\t'; break;
+						case 'r': c = '\r'; break;
+						case 'b': c = '\b'; break;
+						case 'f': c = '\f'; break;
+						// nothing the daemon reads needs more than ascii
+						case 'u': c = '?'; i = std::min(i + 4, text.size() - 1); break;
+						default: c = text[i]; break;
+					}
+				}
+				out += c;
+			}
+			return false;
+		};
+
+		skipSpaces();
+		if (i >= text.size() or text[i++] != '{')
+			return std::nullopt;
+		skipSpaces();
+		if (i < text.size() and text[i] == '}')
+			return fields;
+		while (true) {
+			std::string key, value;
+			skipSpaces();
+			if (not parseString(key))
+				return std::nullopt;
+			skipSpaces();
+			if (i >= text.size() or text[i++] != ':')
+				return std::nullopt;
+			skipSpaces();
+			if (i < text.size() and text[i] == '"') {
+				if (not parseString(value))
+					return std::nullopt;
+			}
+			else {
+				size_t end = text.find_first_of(",}", i);
+				if (end == std::string_view::npos)
+					return std::nullopt;
+				std::string_view raw = text.substr(i, end - i);
+				while (not raw.empty() and std::isspace((unsigned char)raw.back()))
+					raw.remove_suffix(1);
+				if (raw.empty())
+					return std::nullopt;
+				value = raw;
+				i = end;
+			}
+			fields[std::move(key)] = std::move(value);
+			skipSpaces();
+			if (i < text.size() and text[i] == ',') {
+				i++;
+				continue;
+			}
+			if (i < text.size() and text[i] == '}')
+				return fields;
+			return std::nullopt;
+		}
+	}
+
+	std::string Quote(std::string_view text) {
+		std::string quoted = "\"";
+		for (char c : text) {
+			if (c == '"' or c == '\\')
+				quoted += '\\';
+			if ((unsigned char)c < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				quoted += escaped;
+			}
+			else
+				quoted += c;
+		}
+		return quoted + '"';
+	}
+
+	std::string ErrorJson(std::string_view id, std::string_view error) {
+		return "{\"id\":" + Quote(id) + ",\"type\":\"error\",\"error\":" + Quote(error) + "}";
+	}
+
+	// score in pawns for the side to move, mate in moves positive when white mates, like the engine reports them
+	void WriteLine(std::ostream& ostream, const AnalysisLine& line) {
+		ostream << "\"move\":\"" << Move2Chess(line.move) << "\",\"score\":" << line.score << ",\"mate\":";
+		if (line.mate_in)
+			ostream << line.mate_in.value();
+		else
+			ostream << "null";
+		ostream << ",\"pv\":\"";
+		for (size_t i = 0; i < line.line.size(); i++)
+			ostream << (i ? " " : "") << Move2Chess(line.line[i]);
+		ostream << "\"";
+	}
+}
+
+Daemon::Client::~Client() {
+	close(fd);
+}
+
+void Daemon::Client::Send(const std::string& line) {
+	std::lock_guard lock(mutex);
+	if (not open.load(std::memory_order_relaxed))
+		return;
+	std::string data = line + '\n';
+	size_t written = 0;
+	while (written < data.size()) {
+		// a client that went away mustn't kill the daemon with a SIGPIPE
+		ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+		if (n <= 0) {
+			if (n < 0 and errno == EINTR)
+				continue;
+			open = false;
+			return;
+		}
+		written += n;
+	}
+}
+
+bool Daemon::RequestOrder::operator()(const Request& lhs, const Request& rhs) const {
+	// the priority queue puts the greatest first, so this says whether rhs goes before lhs
+	if (lhs.priority != rhs.priority)
+		return lhs.priority < rhs.priority;
+	if (lhs.deadline != rhs.deadline)
+		return not lhs.deadline or (rhs.deadline and *rhs.deadline < *lhs.deadline);
+	return lhs.sequence > rhs.sequence;
+}
+
+Daemon::Searcher::Searcher(TranspositionTable& table, ThreadPool& pool)
+	: engine(chess, pool) {
+	engine.ShareHash(table);
+	engine.SetVerbose(false);
+}
+
+Daemon::Daemon(std::string socketPath, size_t hashMegabytes)
+	: m_SocketPath(std::move(socketPath)), m_TT(hashMegabytes) {
+	unsigned int searchers = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int i = 0; i < searchers; i++)
+		m_Searchers.push_back(std::make_unique<Searcher>(m_TT, m_Pool));
+}
+
+Daemon::~Daemon() {
+	Stop();
+}
+
+void Daemon::Run() {
+	sockaddr_un address{};
+	if (m_SocketPath.size() >= sizeof(address.sun_path))
+		throw std::runtime_error("socket path too long: " + m_SocketPath);
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, m_SocketPath.c_str(), sizeof(address.sun_path) - 1);
+
+	// a socket left by a daemon that didn't shut down cleanly
+	unlink(m_SocketPath.c_str());
+	m_ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (m_ListenFd < 0 or bind(m_ListenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 or listen(m_ListenFd, 64) < 0 or
+		pipe2(m_WakePipe.data(), O_CLOEXEC) < 0) {
+		if (m_ListenFd >= 0)
+			close(m_ListenFd);
+		m_ListenFd = -1;
+		throw std::runtime_error("could not listen on " + m_SocketPath);
+	}
+	s_SignalWakeFd = m_WakePipe[1];
+	std::signal(SIGINT, OnSignal);
+	std::signal(SIGTERM, OnSignal);
+
+	m_Start = std::chrono::steady_clock::now();
+	m_Running = true;
+	std::vector<std::jthread> searchThreads;
+	for (const auto& searcher : m_Searchers)
+		searchThreads.emplace_back([this, &searcher = *searcher](const std::stop_token& stopToken) { SearchLoop(searcher, stopToken); });
+	std::cout << "Listening on " << m_SocketPath << " with " << m_Searchers.size() << " search threads" << std::endl;
+
+	std::vector<std::shared_ptr<Client>> clients;
+	std::vector<pollfd> fds;
+	while (true) {
+		fds = {{m_WakePipe[0], POLLIN, 0}, {m_ListenFd, POLLIN, 0}};
+		for (const auto& client : clients)
+			fds.push_back({client->fd, POLLIN, 0});
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (fds[0].revents)
+			break;
+
+		if (fds[1].revents & POLLIN) {
+			int fd = accept4(m_ListenFd, nullptr, nullptr, SOCK_CLOEXEC);
+			if (fd >= 0)
+				clients.push_back(std::make_shared<Client>(fd));
+		}
+
+		for (size_t i = 0; i + 2 < fds.size(); i++) {
+			if (not fds[i + 2].revents)
+				continue;
+			const std::shared_ptr<Client>& client = clients[i];
+			char buffer[4096];
+			ssize_t n = recv(client->fd, buffer, sizeof(buffer), 0);
+			if (n <= 0) {
+				if (n < 0 and errno == EINTR)
+					continue;
+				client->open = false;
+				continue;
+			}
+			client->input.append(buffer, n);
+			size_t begin = 0;
+			for (size_t end; (end = client->input.find('\n', begin)) != std::string::npos; begin = end + 1) {
+				// whatever a client sends, the daemon keeps serving the others
+				try {
+					HandleLine(client, std::string_view(client->input).substr(begin, end - begin));
+				}
+				catch (const std::exception& exception) {
+					client->Send(ErrorJson("", exception.what()));
+				}
+			}
+			client->input.erase(0, begin);
+			if (client->input.size() > MAX_LINE_LENGTH) {
+				client->Send(ErrorJson("", "line too long"));
+				client->open = false;
+			}
+		}
+		// the socket is closed once its requests still queued or searched let go of it too
+		std::erase_if(clients, [](const auto& client) { return not client->open; });
+	}
+
+	m_Running = false;
+	for (size_t i = 0; i < m_Searchers.size(); i++) {
+		searchThreads[i].request_stop();
+		m_Searchers[i]->engine.Stop();
+	}
+	searchThreads.clear();
+
+	std::signal(SIGINT, SIG_DFL);
+	std::signal(SIGTERM, SIG_DFL);
+	s_SignalWakeFd = -1;
+	close(m_ListenFd);
+	m_ListenFd = -1;
+	unlink(m_SocketPath.c_str());
+	for (int& fd : m_WakePipe) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+void Daemon::Stop() {
+	char wake = 's';
+	if (m_WakePipe[1] >= 0)
+		(void)!write(m_WakePipe[1], &wake, 1);
+}
+
+void Daemon::HandleLine(const std::shared_ptr<Client>& client, std::string_view line) {
+	if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+		return;
+	std::optional<std::unordered_map<std::string, std::string>> fields = ParseObject(line);
+	if (not fields) {
+		client->Send(ErrorJson("", "not a json object"));
+		return;
+	}
+	auto field = [&fields](const std::string& name) -> const std::string* {
+		auto it = fields->find(name);
+		return it == fields->end() ? nullptr : &it->second;
+	};
+
+	Request request;
+	request.client = client;
+	request.arrival = std::chrono::steady_clock::now();
+	if (const std::string* id = field("id"))
+		request.id = *id;
+	if (const std::string* type = field("type"); type and *type == "stats") {
+		client->Send(StatsJson());
+		return;
+	}
+
+	const std::string* fen = field("fen");
+	if (not fen) {
+		client->Send(ErrorJson(request.id, "no fen"));
+		return;
+	}
+	std::optional<Board> parsed;
+	try {
+		parsed.emplace(*fen);
+	}
+	catch (const std::runtime_error&) {
+		client->Send(ErrorJson(request.id, "invalid fen"));
+		return;
+	}
+	const Board& board = parsed.value();
+	const RawBoard& raw = board.GetRawBoard();
+	if (std::ranges::count(raw, 'K') != 1 or std::ranges::count(raw, 'k') != 1) {
+		client->Send(ErrorJson(request.id, "not a legal position"));
+		return;
+	}
+	if (board.IsGameOver()) {
+		client->Send(ErrorJson(request.id, "the game is over"));
+		return;
+	}
+	request.fen = *fen;
+
+	int deadlineMs = 0;
+	const std::array<std::pair<const char*, int*>, 6> integers = {{{"depth", &request.depth}, {"movetime", &request.moveTimeMs},
+		{"multipv", &request.multiPV}, {"mate", &request.mateMoves}, {"priority", &request.priority}, {"deadline", &deadlineMs}}};
+	for (auto [name, value] : integers) {
+		const std::string* text = field(name);
+		if (not text)
+			continue;
+		auto [end, error] = std::from_chars(text->data(), text->data() + text->size(), *value);
+		if (error != std::errc() or end != text->data() + text->size()) {
+			client->Send(ErrorJson(request.id, std::string(name) + " is not an integer"));
+			return;
+		}
+	}
+	request.depth = std::clamp(request.depth, 1, MAX_PLY - 1);
+	request.multiPV = std::max(request.multiPV, 1);
+	request.mateMoves = std::max(request.mateMoves, 0);
+	if (deadlineMs > 0)
+		request.deadline = request.arrival + std::chrono::milliseconds(deadlineMs);
+
+	{
+		std::lock_guard lock(m_QueueMutex);
+		request.sequence = m_NextSequence++;
+		m_Queue.push(std::move(request));
+	}
+	m_QueueChanged.notify_one();
+}
+
+void Daemon::SearchLoop(Searcher& searcher, const std::stop_token& stopToken) {
+	while (true) {
+		Request request;
+		{
+			std::unique_lock lock(m_QueueMutex);
+			// the queued requests are left when the daemon stops
+			if (not m_QueueChanged.wait(lock, stopToken, [this] { return not m_Queue.empty(); }) or stopToken.stop_requested())
+				return;
+			request = m_Queue.top();
+			m_Queue.pop();
+		}
+		// nobody is left to read the answer
+		if (not request.client->open)
+			continue;
+		if (request.deadline and std::chrono::steady_clock::now() >= *request.deadline) {
+			request.client->Send(ErrorJson(request.id, "the deadline passed before the search started"));
+			continue;
+		}
+		Search(searcher, request);
+	}
+}
+
+void Daemon::Search(Searcher& searcher, const Request& request) {
+	Engine& engine = searcher.engine;
+	auto start = std::chrono::steady_clock::now();
+	engine.SetPosition(request.fen);
+	engine.GetSearchOptions().multiPV = request.multiPV;
+	engine.GetSearchOptions().mateSearchMoves = request.mateMoves;
+	if (request.moveTimeMs > 0) {
+		auto moveTime = std::chrono::milliseconds(request.moveTimeMs);
+		if (request.deadline)
+			moveTime = std::min(moveTime, std::chrono::duration_cast<std::chrono::milliseconds>(*request.deadline - start));
+		engine.SetThinkTime((int)std::max<int64_t>(1, moveTime.count()));
+		engine.ApplyThinkingPolicy();
+	}
+	else
+		engine.SetDepth(request.depth);
+
+	// a search to a depth has no deadline of its own, it is stopped from here
+	std::jthread watchdog;
+	if (request.deadline and request.moveTimeMs == 0)
+		watchdog = std::jthread([&engine, deadline = *request.deadline](const std::stop_token& stopToken) {
+			std::mutex mutex;
+			std::condition_variable_any wakeUp;
+			std::unique_lock lock(mutex);
+			wakeUp.wait_until(lock, stopToken, deadline, [] { return false; });
+			while (not stopToken.stop_requested()) {
+				engine.Stop();
+				wakeUp.wait_for(lock, stopToken, STOP_REPEAT, [] { return false; });
+			}
+		});
+
+	engine.SetIterationCallback([&request, start](int depth, const std::vector<AnalysisLine>& lines, uint64_t nodes) {
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(2);
+		ss << "{\"id\":" << Quote(request.id) << ",\"type\":\"info\",\"depth\":" << depth << ",\"nodes\":" << nodes <<
+		",\"time_ms\":" << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << ",";
+		if (not lines.empty())
+			WriteLine(ss, lines.front());
+		ss << "}";
+		request.client->Send(ss.str());
+	});
+
+	try {
+		MoveReturnData data = engine.GetBestMove();
+		const SearchStats& stats = engine.GetLastStats();
+		m_Analysed.fetch_add(1, std::memory_order_relaxed);
+		m_Nodes.fetch_add(stats.nodes, std::memory_order_relaxed);
+
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(2);
+		ss << "{\"id\":" << Quote(request.id) << ",\"type\":\"result\",\"best_move\":\"" << Move2Chess(data.move) <<
+		"\",\"depth\":" << stats.depth << ",\"stopped\":" << (stats.stopped ? "true" : "false") << ",\"nodes\":" << stats.nodes <<
+		",\"time_ms\":" << stats.timeMs <<
+		",\"queued_ms\":" << std::chrono::duration<double, std::milli>(start - request.arrival).count() << ",\"lines\":[";
+		const std::vector<AnalysisLine>& lines = engine.GetLines();
+		for (size_t i = 0; i < lines.size(); i++) {
+			ss << (i ? ",{" : "{");
+			WriteLine(ss, lines[i]);
+			ss << "}";
+		}
+		ss << "]}";
+		request.client->Send(ss.str());
+	}
+	catch (const std::exception& exception) {
+		request.client->Send(ErrorJson(request.id, exception.what()));
+	}
+	engine.SetIterationCallback(nullptr);
+}
+
+std::string Daemon::StatsJson() {
+	size_t queued;
+	{
+		std::lock_guard lock(m_QueueMutex);
+		queued = m_Queue.size();
+	}
+	double uptimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+	uint64_t analysed = m_Analysed.load(std::memory_order_relaxed);
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2);
+	ss << "{\"type\":\"stats\",\"analysed\":" << analysed << ",\"queued\":" << queued << ",\"nodes\":" << m_Nodes.load(std::memory_order_relaxed) <<
+	",\"uptime_ms\":" << uptimeMs << ",\"positions_per_s\":" << (uptimeMs > 0 ? analysed * 1000.0 / uptimeMs : 0) << "}";
+	return ss.str();
+}
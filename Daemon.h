@@ -0,0 +1,94 @@
+#pragma once
+#include "Engine.h"
+
+// serves analysis requests over a unix socket, one json object per line each way, so the engines and their hash table
+// stay warm from one request to the next
+// a search thread per core takes the requests, each with an engine of its own, all of them sharing one hash table
+//
+// a request: {"id":"a1","fen":"...","depth":8,"movetime":500,"multipv":1,"mate":0,"priority":0,"deadline":2000}
+//   everything but the fen is optional, the id is echoed back in every answer to the request
+//   movetime searches until then, otherwise depth, 8 by default, is searched to the end
+//   mate runs the mate solver next to the search for mates in that many moves, it takes a core from the other searchers
+//   the highest priority is searched first, then the earliest deadline, then the oldest request
+//   the deadline is in ms from the arrival, the search is stopped then and a request still queued gets an error
+// the answers: {"id":"a1","type":"info",...} after every depth, then {"id":"a1","type":"result",...}
+//   or {"id":"a1","type":"error","error":"..."}
+// {"type":"stats"} is answered right away with the positions analysed since the start and per second
+class Daemon {
+public:
+	explicit Daemon(std::string socketPath, size_t hashMegabytes = 64);
+	Daemon(const Daemon&) = delete;
+	Daemon& operator=(const Daemon&) = delete;
+	~Daemon();
+
+	// serves until Stop is called or the process gets SIGINT or SIGTERM
+	// throws std::runtime_error if the socket can't be listened on
+	void Run();
+	// safe to call from any thread
+	void Stop();
+private:
+	struct Client {
+		explicit Client(int fd) : fd(fd) {}
+		~Client();
+
+		// whole lines only, the answers of two requests never interleave within a line
+		void Send(const std::string& line);
+
+		int fd;
+		std::string input;
+		std::mutex mutex;
+		std::atomic_bool open = true;
+	};
+
+	struct Request {
+		std::shared_ptr<Client> client;
+		std::string id;
+		std::string fen;
+		int depth = 8;
+		int moveTimeMs = 0;
+		int multiPV = 1;
+		int mateMoves = 0;
+		int priority = 0;
+		std::optional<std::chrono::steady_clock::time_point> deadline;
+		std::chrono::steady_clock::time_point arrival;
+		uint64_t sequence = 0;
+	};
+
+	// the request searched next comes first
+	struct RequestOrder {
+		bool operator()(const Request& lhs, const Request& rhs) const;
+	};
+
+	void HandleLine(const std::shared_ptr<Client>& client, std::string_view line);
+	struct Searcher {
+		Searcher(TranspositionTable& table, ThreadPool& pool);
+
+		Chess chess;
+		Engine engine;
+	};
+
+	// a search thread, it takes the requests one by one and searches each on its engine
+	void SearchLoop(Searcher& searcher, const std::stop_token& stopToken);
+	void Search(Searcher& searcher, const Request& request);
+	[[nodiscard]] std::string StatsJson();
+
+	std::string m_SocketPath;
+	int m_ListenFd = -1;
+	// written to wake the poll, by Stop and by the signal handler
+	std::array<int, 2> m_WakePipe = {-1, -1};
+	std::atomic_bool m_Running = false;
+
+	TranspositionTable m_TT;
+	// the engines search on their own threads, the pool only builds the bitbases and clears the table
+	ThreadPool m_Pool;
+	std::vector<std::unique_ptr<Searcher>> m_Searchers;
+
+	std::mutex m_QueueMutex;
+	std::condition_variable_any m_QueueChanged;
+	std::priority_queue<Request, std::vector<Request>, RequestOrder> m_Queue;
+	uint64_t m_NextSequence = 0;
+
+	std::chrono::steady_clock::time_point m_Start;
+	std::atomic<uint64_t> m_Analysed = 0;
+	std::atomic<uint64_t> m_Nodes = 0;
+};
@@ -1,39 +1,174 @@
 #include "Engine.h"
+#include "Bitbases.h"
 
-Engine::Engine(Chess& c) : m_Chess(c),
-						   m_Tree(std::make_unique<TreeNode>(TreeNode(Move(),m_Chess.GetBoard().IsWhiteTurn()))) {
+namespace {
+	// a window this narrow only answers if a score is above or below its bound
+	constexpr Score NULL_WINDOW = 0.01f;
+	// anything beyond this is a mate score
+	constexpr Score MATE_BOUND = StaticEvaluator::WIN - MAX_PLY;
+
+	constexpr int REVERSE_FUTILITY_DEPTH = 6;
+	constexpr Score REVERSE_FUTILITY_MARGIN = 1.2f;
+	constexpr std::array<Score, 3> RAZOR_MARGIN = {0, 3.f, 5.f};
+	constexpr std::array<Score, 4> FUTILITY_MARGIN = {0, 1.5f, 3.5f, 5.5f};
+	// near the leaves, moves that lose more than this much material times the depth in the exchange are not searched
+	constexpr int SEE_PRUNING_DEPTH = 3;
+	constexpr int SEE_QUIET_MARGIN = 60;
+	constexpr int SEE_CAPTURE_MARGIN = 100;
+	constexpr int NULL_MOVE_DEPTH = 3;
+	// from this depth on a null move cutoff is verified by a reduced search, which catches most zugzwangs
+	constexpr int NULL_MOVE_VERIFICATION_DEPTH = 8;
+	constexpr int LATE_MOVE_DEPTH = 3;
+	constexpr int MAX_HISTORY = 16384;
+	// how many nodes a thread searches between two looks at the clock, a power of two
+	constexpr uint64_t STOP_CHECK_INTERVAL = 256;
+	// iterations from this depth on start with a window around the last score
+	constexpr int ASPIRATION_DEPTH = 4;
+	constexpr Score ASPIRATION_WINDOW = 0.5f;
+
+	// while thinking, the tree is split until there are this many frontier nodes per thread
+	constexpr size_t FRONTIER_NODES_PER_THREAD = 4;
+	// frontier searches queued per thread, so a worker that runs dry has one to steal
+	constexpr int FRONTIER_JOBS_PER_THREAD = 2;
+	// a frontier node a ply deeper than another needs to be this much better to be deepened first
+	constexpr float FRONTIER_DEPTH_WEIGHT = 1.f;
+	constexpr float FRONTIER_BEST_LINE_BONUS = 0.5f;
+
+	// reductions grow with the log of the depth and of the index of the move
+	std::array<std::array<int, MAX_PLY>, MAX_PLY> GenerateReductions() {
+		std::array<std::array<int, MAX_PLY>, MAX_PLY> reductions{};
+		for (int depth = 1; depth < MAX_PLY; depth++)
+			for (int index = 1; index < MAX_PLY; index++)
+				reductions[depth][index] = (int)(0.75 + std::log(depth) * std::log(index) / 2.25);
+		return reductions;
+	}
+	const std::array<std::array<int, MAX_PLY>, MAX_PLY> LATE_MOVE_REDUCTIONS = GenerateReductions();
+
+	int SquareIndex(const Coord& coord) { return coord.first * 8 + coord.second; }
 }
 
-void Engine::ApplyMove(const Move& move) {
+template<BoardRepresentation B>
+BasicEngine<B>::BasicEngine(BasicChess<B>& c, size_t threads)
+	: BasicEngine(c, std::make_unique<ThreadPool>(threads, [](int index) {
+		if (Memory::IsPinningThreads())
+			Memory::PinThread(index);
+		if (PerfCounters::IsEnabled())
+			PerfCounters::OpenForThread();
+	}), nullptr) {}
+
+template<BoardRepresentation B>
+BasicEngine<B>::BasicEngine(BasicChess<B>& c, ThreadPool& pool)
+	: BasicEngine(c, nullptr, &pool) {}
+
+template<BoardRepresentation B>
+BasicEngine<B>::BasicEngine(BasicChess<B>& c, std::unique_ptr<ThreadPool> ownPool, ThreadPool* sharedPool) : m_Chess(c),
+						   m_Tree(std::make_unique<TreeNode>(TreeNode(Move(),m_Chess.GetBoard().IsWhiteTurn()))),
+						   m_OwnPool(std::move(ownPool)),
+						   m_Pool(sharedPool ? sharedPool : m_OwnPool.get()) {
+	m_ThreadCounters.resize(m_Pool->GetThreadCount());
+	m_ThreadData.resize(m_Pool->GetThreadCount());
+	// shared by every engine of the process, only the first one builds them
+	Bitbases::Init(m_Pool);
+}
+
+template<BoardRepresentation B>
+BasicEngine<B>::~BasicEngine() {
+	// the queued frontier searches return right away, the running ones at their next stop check
+	m_Thinking = false;
+	Stop();
+}
+
+template<BoardRepresentation B>
+void BasicEngine<B>::SetHashSize(size_t megabytes) {
+	m_TT->Resize(megabytes);
+}
+
+template<BoardRepresentation B>
+void BasicEngine<B>::ClearHash() {
+	m_TT->Clear(m_Pool);
+}
+
+template<BoardRepresentation B>
+void BasicEngine<B>::ClearHistory() {
+	for (SearchThreadData& data : m_ThreadData)
+		data = {};
+}
+
+template<BoardRepresentation B>
+bool BasicEngine<B>::LoadHash(const std::string& path, bool shared) {
+	return m_TT->Load(path, shared, m_Pool);
+}
+
+template<BoardRepresentation B>
+void BasicEngine<B>::SaveHash(const std::string& path) const {
+	m_TT->Save(path);
+}
+
+template<BoardRepresentation B>
+void BasicEngine<B>::ApplyMove(const Move& move) {
 	m_Chess.ApplyMove(move);
 
 	// set the new head of tree
 	m_Tree = std::make_unique<TreeNode>(TreeNode(Move(),m_Chess.GetBoard().IsWhiteTurn()));
-	for (auto& node : m_NodesPerThread)
-		node = 0;
+	for (auto& counters : m_ThreadCounters)
+		counters = {};
 }
 
-void Engine::LoadingBar(const std::stop_token& st, const Score* score) {
+template<BoardRepresentation B>
+void BasicEngine<B>::SetPosition(const std::string& fen) {
+	m_Chess = BasicChess<B>(fen);
+	m_Tree = std::make_unique<TreeNode>(TreeNode(Move(), m_Chess.GetBoard().IsWhiteTurn()));
+	for (auto& counters : m_ThreadCounters)
+		counters = {};
+}
+
+template<BoardRepresentation B>
+void BasicEngine<B>::LoadingBar(const std::stop_token& st, const std::atomic<Score>* score) {
 	using namespace std::chrono_literals;
 	int i = 0;
+	std::mutex mutex;
+	std::condition_variable_any wakeUp;
+	std::unique_lock lock(mutex);
 	while (not st.stop_requested()) {
 		std::cout << "\r" << "[" << std::string(i, '.') <<
-				  std::string(10 - i, ' ') << "]" << " Score: " << *score << "        " << std::flush;
+				  std::string(10 - i, ' ') << "]" << " Score: " << score->load(std::memory_order_relaxed) << "        " << std::flush;
 		i = (i + 1) % 10;
-		std::this_thread::sleep_for(200ms);
+		// wakes up as soon as the search is done instead of finishing the nap
+		wakeUp.wait_for(lock, st, 200ms, [] { return false; });
 	}
 	std::cout << "\rDone!" << std::string(100, ' ') << std::endl;
 }
 
-void Engine::ApplyThinkingPolicy() {
-	std::string message = "Thinking\t";
-	// std::jthread loadingThread(LoadingBar, &message);
-	std::this_thread::sleep_for(std::chrono::milliseconds(m_msThinkTime));
-	message = "Stopping\t";
-	StopThinking();
+// the next search has to return within the think time, it deepens until then instead of stopping at the depth
+template<BoardRepresentation B>
+void BasicEngine<B>::ApplyThinkingPolicy() {
+	m_Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_msThinkTime);
+	m_HasDeadline = true;
 }
 
-Board Engine::GetBoardFromNode(TreeNode* node) const {
+template<BoardRepresentation B>
+void BasicEngine<B>::Stop() {
+	m_Stop.store(true, std::memory_order_relaxed);
+}
+
+// polled by every node, the clock is only read every STOP_CHECK_INTERVAL nodes
+template<BoardRepresentation B>
+bool BasicEngine<B>::ShouldStop(const ThreadSearchCounters& counters) const {
+	if (not m_CanStop)
+		return false;
+	if ((counters.nodes & (STOP_CHECK_INTERVAL - 1)) == 0 and ((m_HasDeadline and std::chrono::steady_clock::now() >= m_Deadline) or
+		(m_NodeLimit and counters.nodes >= m_NodeLimit)))
+		m_Stop.store(true, std::memory_order_relaxed);
+	return m_Stop.load(std::memory_order_relaxed);
+}
+
+template<BoardRepresentation B>
+bool BasicEngine<B>::IsStopped() const {
+	return m_CanStop and m_Stop.load(std::memory_order_relaxed);
+}
+
+template<BoardRepresentation B>
+B BasicEngine<B>::GetBoardFromNode(TreeNode* node) const {
 	PROFILE_SCOPE;
 
 	std::stack<Move> moveStack;
@@ -42,7 +177,7 @@ Board Engine::GetBoardFromNode(TreeNode* node) const {
 		node = node->parent;
 	}
 
-	Board board = m_Chess.GetBoard();
+	B board = m_Chess.GetBoard();
 
 	while (not moveStack.empty()) {
 		board.ApplyMove(moveStack.top());
@@ -52,82 +187,145 @@ Board Engine::GetBoardFromNode(TreeNode* node) const {
 	return board;
 }
 
-// expands the node with a certain depth, and calculates the score of the nodes it creates
-// that score is not permanent and will change over time as the tree is expanded
-void Engine::ExpandNode(TreeNode* node, int depth, int threadId) {
-	const Board board = GetBoardFromNode(node);
+// searches a frontier node one depth after the other up to the depth, the earlier ones were done by the jobs before
+// the score is not permanent and will change over time as the tree is expanded
+template<BoardRepresentation B>
+void BasicEngine<B>::ExpandNode(TreeNode* node, int depth, int threadId) {
+	const B board = GetBoardFromNode(node);
+	const int ply = GetPly(node);
+	SearchThreadData& data = m_ThreadData[threadId];
 
-	// if the game is over, don't expand the node
-	if (board.IsGameOver()) {
-		node->score = StaticEvaluator::Evaluate(board);
-		return;
-	}
+	int searched = node->depth;
+	Score score = node->score;
+	std::vector<Move> pv;
+	data.previousPv.clear();
+	data.onPreviousPv[ply] = false;
+	for (int d = searched + 1; d <= depth; d++) {
+		Score result = Search(board, StaticEvaluator::LOSS, StaticEvaluator::WIN, d, ply, threadId, true);
+		if (IsStopped())
+			break;
+		score = result;
+		pv.assign(data.pv[ply].begin() + ply, data.pv[ply].begin() + data.pvLength[ply]);
+		searched = d;
 
-	// https://en.wikipedia.org/wiki/Principal_variation_search
-	// use pvs to calculate the score of the node
+		// a finished game or a mate within the depth can't change anymore, the node is never deepened again
+		std::optional<int> mate = MateDistance(score, ply);
+		if (board.IsGameOver() or (mate and mate.value() <= d)) {
+			searched = MAX_PLY - ply;
+			break;
+		}
+	}
 
+	std::lock_guard lock(m_TreeMutex);
+	node->searching = false;
+	m_FrontierJobs--;
+	if (searched > node->depth) {
+		node->score = score;
+		node->mate_in = MateDistance(score, ply);
+		node->pv = std::move(pv);
+		node->depth = searched;
+		BackUp(node->parent);
+	}
+	ScheduleFrontier();
 }
 
-void Engine::ThreadWorker(int threadId) {
-	while (true) {
-		// get the next node to expand
-		TreeNode* node;
-		{
-			std::unique_lock lock(m_QueueMutex);
-			// condition must be true to continue
-			m_QueueCondition.wait(lock, [this] { return not m_Queue.empty() or not m_Thinking; });
-
-			if (not m_Thinking){
-				return;
-			}
-
-			node = m_Queue.front();
-			m_Queue.pop();
+// negamax over the children that were searched, up to the root
+template<BoardRepresentation B>
+void BasicEngine<B>::BackUp(TreeNode* node) {
+	for (; node; node = node->parent) {
+		TreeNode* best = nullptr;
+		int depth = MAX_PLY;
+		for (const auto& child : node->children) {
+			depth = std::min(depth, child->depth);
+			if (child->depth > 0 and (not best or child->score < best->score))
+				best = child.get();
 		}
-		ExpandNode(node, m_BatchDepth, threadId);
+		if (not best)
+			return;
+
+		node->bestChild = best;
+		node->score = -best->score;
+		node->mate_in = MateDistance(node->score, GetPly(node));
+		node->pv.clear();
+		node->pv.push_back(best->delta);
+		node->pv.insert(node->pv.end(), best->pv.begin(), best->pv.end());
+		// the depth every child was searched to, so 0 until they all were
+		node->depth = depth > 0 ? depth + 1 : 0;
+		if (not node->parent)
+			m_RootScore.store(node->score, std::memory_order_relaxed);
 	}
 }
 
-void Engine::ClearQueue() {
-	std::queue<TreeNode*> empty;
-	std::swap(m_Queue,empty);
-}
+template<BoardRepresentation B>
+void BasicEngine<B>::ScheduleFrontier() {
+	while (m_Thinking and m_FrontierJobs < (int)m_Pool->GetThreadCount() * FRONTIER_JOBS_PER_THREAD) {
+		TreeNode* next = nullptr;
+		float nextPriority = 0;
+		for (TreeNode* node : m_Frontier) {
+			if (node->searching or node->depth >= MAX_PLY - GetPly(node))
+				continue;
+			float priority = FrontierPriority(node);
+			if (not next or priority > nextPriority) {
+				next = node;
+				nextPriority = priority;
+			}
+		}
+		if (not next)
+			return;
 
-void Engine::AddToQueue(TreeNode* node) {
-	std::lock_guard lock(m_QueueMutex);
-	m_Queue.push(node);
-	m_QueueCondition.notify_one();
+		next->searching = true;
+		m_FrontierJobs++;
+		// the first search of a node goes down to the batch depth from the root, every later one a ply deeper
+		AddToQueue(next, next->depth ? next->depth + 1 : std::max(1, m_BatchDepth - GetPly(next)));
+	}
 }
 
-void Engine::AddManyToQueue(const std::vector<std::unique_ptr<TreeNode>>::iterator& begin,
-							const std::vector<std::unique_ptr<TreeNode>>::iterator& end) {
-	std::lock_guard lock(m_QueueMutex);
-	int size = 0;
+// the nodes that were never searched come first, in the order the split found them
+// then the shallow ones, and among those the ones on the best lines
+template<BoardRepresentation B>
+float BasicEngine<B>::FrontierPriority(const TreeNode* node) const {
+	if (node->depth == 0)
+		return std::numeric_limits<float>::max();
 
-	// add jobs to the queue
-	for (auto it = begin; it != end; it++) {
-		m_Queue.push(it->get());
-		size++;
+	// how good the root move leading to the node is, mates don't count for more than a few pawns
+	const TreeNode* rootMove = node;
+	bool bestLine = true;
+	while (rootMove->parent and rootMove->parent->parent) {
+		bestLine = bestLine and rootMove->parent->bestChild == rootMove;
+		rootMove = rootMove->parent;
 	}
+	float score = rootMove->parent ? std::clamp(-rootMove->score, -10.f, 10.f) : 0;
+	return score + (bestLine ? FRONTIER_BEST_LINE_BONUS : 0) - FRONTIER_DEPTH_WEIGHT * (float)node->depth;
+}
+
+template<BoardRepresentation B>
+int BasicEngine<B>::GetPly(const TreeNode* node) {
+	int ply = 0;
+	for (const TreeNode* parent = node->parent; parent; parent = parent->parent)
+		ply++;
+	return ply;
+}
 
-	// notify for each new job
-	for (int i = 0; i < size; i++)
-		m_QueueCondition.notify_one();
+template<BoardRepresentation B>
+void BasicEngine<B>::AddToQueue(TreeNode* node, int depth) {
+	m_ThinkTasks.Submit([this, node, depth] {
+		// the thread waiting on the batch helps with its tasks, but it has no search state of its own
+		int threadId = m_Pool->GetWorkerIndex();
+		if (m_Thinking and threadId >= 0)
+			ExpandNode(node, depth, threadId);
+	});
 }
 
-std::vector<Move> Engine::GetLine(TreeNode* node) {
+template<BoardRepresentation B>
+std::vector<Move> BasicEngine<B>::GetLine(TreeNode* node) {
 	std::vector<Move> line;
 	line.push_back(node->delta);
-
-	while (not node->children.empty()) {
-		line.push_back(node->bestChild->delta);
-		node = node->bestChild;
-	}
-
+	line.insert(line.end(), node->pv.begin(), node->pv.end());
 	return line;
 }
 
-std::string Engine::LineToString(const std::vector<Move>& line) {
+template<BoardRepresentation B>
+std::string BasicEngine<B>::LineToString(const std::vector<Move>& line) {
 	std::stringstream ss;
 	for (const Move& move : line) {
 		ss << move << " | ";
@@ -135,130 +333,786 @@ std::string Engine::LineToString(const std::vector<Move>& line) {
 	return ss.str();
 }
 
-void Engine::Think() {
+// splits the tree into a frontier with enough nodes to keep every thread busy, the pool searches them from there
+template<BoardRepresentation B>
+void BasicEngine<B>::Think() {
+	StopThinking();
 	m_Thinking = true;
-	ClearQueue();
-
-	// create the root node
 	m_Tree = std::make_unique<TreeNode>(Move(), m_Chess.GetBoard().IsWhiteTurn(), nullptr);
-	AddToQueue(m_Tree.get());
+	for (auto& counters : m_ThreadCounters)
+		counters = {};
+	m_TT->NewSearch();
+	m_LastStats = {};
+	m_ThinkStart = std::chrono::steady_clock::now();
+	m_Stop.store(false, std::memory_order_relaxed);
+	m_CanStop = true;
 
-	// start the treads
-	for (int threadId = 0; threadId < n_Threads ; threadId++)
-		m_Threads[threadId] = std::thread(&Engine::ThreadWorker, this, threadId);
+	// every node of the frontier is replaced by its children, in the order they should be searched
+	std::vector<TreeNode*> frontier = {m_Tree.get()};
+	while (frontier.size() < m_Pool->GetThreadCount() * FRONTIER_NODES_PER_THREAD) {
+		std::vector<TreeNode*> next;
+		for (TreeNode* node : frontier) {
+			const B board = GetBoardFromNode(node);
+			const int ply = GetPly(node);
+			if (board.IsGameOver() or ply + 1 >= m_BatchDepth) {
+				next.push_back(node);
+				continue;
+			}
+			std::vector<Move> moves = board.GetLegalMoves();
+			OrderMoves(board, moves, ply, 0);
+			for (const Move& move : moves) {
+				node->children.push_back(std::make_unique<TreeNode>(move, not node->whiteTurn, node));
+				next.push_back(node->children.back().get());
+			}
+		}
+		if (next.size() == frontier.size())
+			break;
+		frontier = std::move(next);
+	}
 
-	// start a batch for each job in the queue
-	for (int i = 0 ; i < m_Queue.size(); i++)
-		m_QueueCondition.notify_one();
+	std::lock_guard lock(m_TreeMutex);
+	m_Frontier = std::move(frontier);
+	m_FrontierJobs = 0;
+	ScheduleFrontier();
 }
 
-void Engine::StopThinking() {
-	m_Thinking = false;
-	// make sure no threads are waiting for a job
-	m_QueueCondition.notify_all();
+template<BoardRepresentation B>
+void BasicEngine<B>::StopThinking() {
+	bool wasThinking = m_Thinking.exchange(false);
+	Stop();
+	// the jobs still queued see m_Thinking and return right away
+	m_ThinkTasks.Wait();
+	m_Frontier.clear();
+	m_Stop.store(false, std::memory_order_relaxed);
+	if (not wasThinking or not m_Tree->bestChild)
+		return;
+
+	// the next search starts with the best moves of the thinking
+	std::stable_sort(m_Tree->children.begin(), m_Tree->children.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs->depth > 0 and (rhs->depth == 0 or lhs->score < rhs->score);
+	});
+
+	m_LastStats.fen = m_Chess.GetBoard().GetFen();
+	m_LastStats.bestMove = m_Tree->bestChild->delta;
+	m_LastStats.score = m_Tree->score;
+	// the other moves may not all have been searched as deep, or at all
+	m_LastStats.depth = m_Tree->bestChild->depth + 1;
+	m_LastStats.stopped = true;
+	m_LastStats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_ThinkStart).count();
+	m_LastStats.Accumulate(m_ThreadCounters, Timer::TicksPerMicrosecond() * 1000.0);
 
-	for (std::thread& thread : m_Threads)
-		thread.join();
+	if (m_Verbose) {
+		std::cout << "Thought about " << ScoreLabel(m_Tree->bestChild) << ":\t" << LineToString(m_Tree->pv) << std::endl;
+		std::cout << m_LastStats << std::endl;
+	}
+	if (m_StatsWriter)
+		m_StatsWriter->Write(m_LastStats);
 }
 
-MoveReturnData Engine::GetBestMove() {
+template<BoardRepresentation B>
+MoveReturnData BasicEngine<B>::GetBestMove() {
 	// throw an error if game is over
 	if (m_Chess.IsGameOver())
 		throw std::runtime_error("Game is over");
 
+	if (m_Book)
+		if (std::optional<Move> move = m_Book->PickMove(m_Chess.GetBoard(), (uint64_t)Randint(0, std::numeric_limits<int>::max()))) {
+			m_LastStats = {};
+			m_LastStats.fen = m_Chess.GetBoard().GetFen();
+			m_Lines = {{*move, 0, std::nullopt, {*move}}};
+			return {*move, 0, std::nullopt};
+		}
+
+	if (PerfCounters::IsEnabled())
+		PerfCounters::OpenForThread();
+
+	for (auto& counters : m_ThreadCounters)
+		counters = {};
+	m_TT->NewSearch();
+	// the history of the last move is still a good guess, but it shouldn't outweigh this one
+	for (SearchThreadData& data : m_ThreadData) {
+		data.killers = {};
+		data.previousPv.clear();
+		for (auto& player : data.history)
+			for (auto& from : player)
+				for (int& entry : from)
+					entry /= 2;
+	}
+	m_LastStats = {};
+	m_LastStats.fen = m_Chess.GetBoard().GetFen();
+
 	// calculate the score for each node
 	{
-		std::jthread thread(Engine::LoadingBar, &m_Tree->score);
+		m_RootScore = 0;
+		std::jthread thread;
+		if (m_Verbose)
+			thread = std::jthread(BasicEngine::LoadingBar, &m_RootScore);
 
 		PROFILE_SCOPE_NAME("EvaluateNode");
-		Engine::EvaluateNode(m_Tree.get(), StaticEvaluator::LOSS, StaticEvaluator::WIN, m_BatchDepth);
-	}
+		auto start = std::chrono::steady_clock::now();
+		// the first pass of the first iteration always finishes so there is a move to play
+		m_CanStop = false;
+		m_Stop.store(false, std::memory_order_relaxed);
+		int maxDepth = m_HasDeadline or m_NodeLimit ? MAX_PLY - 1 : m_BatchDepth;
 
-	int totalNodes = std::accumulate(m_NodesPerThread.begin(), m_NodesPerThread.end(), 0);
-	std::cout << totalNodes / 1000 << " k nodes" << std::endl;
-	std::cout << "Cache hits: " << Board::GetCacheHits();
-	std::cout << " Cache misses: " << Board::GetCacheMisses();
-	std::cout << std::fixed << std::setprecision(2) << " Cache hit rate " <<
-	Board::GetCacheHitRate() * 100 << "%" << std::endl;
-
-	std::cout << "\nBest lines:\n";
-	std::array<TreeNode*, 3> bestChildren{};
-	for (auto & i : bestChildren) {
-		TreeNode* bestChild = nullptr;
-		for (auto& child : m_Tree->children) {
-			if (std::find(bestChildren.begin(), bestChildren.end(), child.get()) != bestChildren.end())
-				continue;
+		// the solver proves deep forced mates much faster than the search, which it then stops
+		MateResult mate;
+		std::jthread mateThread;
+		if (m_SearchOptions.mateSearchMoves > 0)
+			mateThread = std::jthread([this, &mate, board = m_Chess.GetBoard()](std::stop_token st) {
+				mate = m_MateSolver.FindMate(board, m_SearchOptions.mateSearchMoves, st);
+				if (mate.mateIn)
+					Stop();
+			});
 
-			if (not bestChild or child->score < bestChild->score)
-				bestChild = child.get();
+		// iterative deepening, every iteration orders the next one
+		std::vector<AnalysisLine> lines;
+		for (int depth = 1; depth <= maxDepth; depth++) {
+			// an iteration takes longer than all the ones before it, don't start one that can't finish
+			if (m_HasDeadline and depth > 1) {
+				auto now = std::chrono::steady_clock::now();
+				if (now >= m_Deadline or now - start > (m_Deadline - start) / 2)
+					break;
+			}
+
+			std::vector<AnalysisLine> iterationLines;
+
+			// multipv: every pass searches the root without the moves found by the passes before it
+			// the found moves are rotated in front of the children so a pass only has to skip a prefix
+			for (size_t pv = 0; pv < (size_t)std::max(1, m_SearchOptions.multiPV); pv++) {
+				if (pv > 0 and pv >= m_Tree->children.size())
+					break;
+
+				Score previous = pv < lines.size() ? lines[pv].score : m_Tree->score;
+				Score alpha = StaticEvaluator::LOSS;
+				Score beta = StaticEvaluator::WIN;
+				Score window = ASPIRATION_WINDOW;
+				if (depth >= ASPIRATION_DEPTH and std::abs(previous) < MATE_BOUND) {
+					alpha = previous - window;
+					beta = previous + window;
+				}
+				// a line can't be better than the one found before it, so that bounds the window from above
+				if (pv > 0)
+					beta = std::min(beta, iterationLines.back().score + NULL_WINDOW);
+				alpha = std::min(alpha, beta - NULL_WINDOW);
+
+				// the window grows until the score falls inside it
+				while (true) {
+					Score score = BasicEngine::EvaluateNode(m_Tree.get(), alpha, beta, depth, 0, pv);
+					if (IsStopped())
+						break;
+					if (score <= alpha and alpha > StaticEvaluator::LOSS)
+						alpha = std::max(StaticEvaluator::LOSS, score - window);
+					else if (score >= beta and beta < StaticEvaluator::WIN)
+						beta = std::min(StaticEvaluator::WIN, score + window);
+					else
+						break;
+					window *= 2;
+					m_ThreadCounters[0].aspirationResearches++;
+				}
+
+				// a game over root has no children and nothing to report
+				if (IsStopped() or not m_Tree->bestChild)
+					break;
+				auto best = std::find_if(m_Tree->children.begin() + (long)pv, m_Tree->children.end(),
+										 [this](const auto& child) { return child.get() == m_Tree->bestChild; });
+				std::rotate(m_Tree->children.begin() + (long)pv, best, best + 1);
+
+				const TreeNode* child = m_Tree->children[pv].get();
+				iterationLines.push_back({child->delta, -child->score, MateInMoves(child), GetLine(m_Tree->children[pv].get())});
+				m_CanStop = true;
+			}
+
+			// an interrupted iteration is thrown away, the last completed one is what we play
+			// unless it is the first one, then the lines found before the stop are all we have
+			if (IsStopped()) {
+				if (lines.empty())
+					lines = std::move(iterationLines);
+				m_LastStats.stopped = true;
+				break;
+			}
+
+			// search the best moves of this iteration first in the next one
+			size_t found = iterationLines.size();
+			std::stable_sort(m_Tree->children.begin() + (long)std::min(found, m_Tree->children.size()), m_Tree->children.end(),
+							 [](const auto& lhs, const auto& rhs) { return lhs->score < rhs->score; });
+
+			lines = std::move(iterationLines);
+			SetRootLines(lines);
+			m_ThreadData[0].previousPv = m_Tree->pv;
+			m_ThreadData[0].onPreviousPv[0] = true;
+			m_LastStats.depth = depth;
+			if (m_IterationCallback) {
+				uint64_t nodes = 0;
+				for (const ThreadSearchCounters& counters : m_ThreadCounters)
+					nodes += counters.nodes;
+				m_IterationCallback(depth, lines, nodes);
+			}
 		}
-		if (not bestChild)
-			break;
-		i = bestChild;
+		if (mateThread.joinable()) {
+			mateThread.request_stop();
+			mateThread.join();
+		}
+		// a proven mate is played unless the search found one at least as short
+		if (mate.mateIn and not mate.line.empty()) {
+			Score mateScore = StaticEvaluator::WIN - (Score)(2 * mate.mateIn.value() - 1);
+			if (lines.empty() or lines.front().score < mateScore) {
+				std::erase_if(lines, [&mate](const AnalysisLine& line) { return line.move == mate.line.front(); });
+				lines.insert(lines.begin(), {mate.line.front(), mateScore, std::nullopt, mate.line});
+				lines.resize(std::min(lines.size(), (size_t)std::max(1, m_SearchOptions.multiPV)));
+			}
+			if (m_Verbose)
+				std::cout << "Mate in " << mate.mateIn.value() << " proven in " << mate.timeMs << "[ms], " << mate.nodes <<
+				" nodes, proof size " << mate.proofSize << std::endl;
+		}
+
+		// the interrupted iteration may have overwritten the root children
+		SetRootLines(lines);
+		for (size_t i = 0; i < lines.size(); i++)
+			lines[i].mate_in = MateInMoves(m_Tree->children[i].get());
+		m_Lines = std::move(lines);
+		m_HasDeadline = false;
+		m_LastStats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
 
-		std::cout << ScoreLabel(bestChild) << ":\t" << LineToString(GetLine(bestChild)) << std::endl;
-		while (bestChild->bestChild) {
-			bestChild = bestChild->bestChild;
+	m_LastStats.Accumulate(m_ThreadCounters, Timer::TicksPerMicrosecond() * 1000.0);
+
+	if (m_Verbose) {
+		if (PerfCounters::IsEnabled())
+			PerfCounters::PrintSummary(std::cout, PerfCounters::CollectMove());
+
+		std::cout << "\nBest lines:\n";
+		for (size_t i = 0; i < m_Lines.size(); i++) {
+			const TreeNode* child = m_Tree->children[i].get();
+			std::cout << ScoreLabel(child) << ":\t" << LineToString(m_Lines[i].line) << std::endl;
+			B board = m_Chess.GetBoard();
+			for (const Move& move : m_Lines[i].line)
+				board.ApplyMove(move);
+			std::cout << board.GetFen() << std::endl;
 		}
-		std::cout << GetBoardFromNode(bestChild).GetFen() << std::endl;
+		std::cout << std::endl;
 	}
-	std::cout << std::endl;
 
-	// flip the 'mate in' value if it's black's turn
-	std::optional<int> mate_in;
-	if (bestChildren[0]->mate_in)
-		mate_in = bestChildren[0]->whiteTurn ? bestChildren[0]->mate_in.value() : -bestChildren[0]->mate_in.value();
-	return {bestChildren[0]->delta, bestChildren[0]->score, mate_in};
+	const TreeNode* bestChild = m_Tree->children.front().get();
+	m_LastStats.bestMove = bestChild->delta;
+	m_LastStats.score = m_Tree->score;
+	if (m_Verbose)
+		std::cout << m_LastStats << std::endl;
+	if (m_StatsWriter)
+		m_StatsWriter->Write(m_LastStats);
+	return {bestChild->delta, bestChild->score, MateInMoves(bestChild)};
 }
 
-// use pvs to evaluate the score of the node
+// use pvs to evaluate the score of the node, the children are searched with Search
 // https://en.wikipedia.org/wiki/Principal_variation_search#Pseudocode
-Score Engine::EvaluateNode(TreeNode* node, Score alpha, Score beta, int depth) const {
-	Board board = GetBoardFromNode(node);
-	m_NodesPerThread[0]++;
-
-	// if the node is a leaf, return the static evaluation
-	if (depth == 0 or board.GetLegalMoves().empty()) {
-		node->score = StaticEvaluator::Evaluate(board);
-		if (node->score == StaticEvaluator::LOSS)
-			node->mate_in = 0;
+template<BoardRepresentation B>
+Score BasicEngine<B>::EvaluateNode(TreeNode* node, Score alpha, Score beta, int depth, int threadId, size_t firstChild) const {
+	B board = GetBoardFromNode(node);
+	ThreadSearchCounters& counters = m_ThreadCounters[threadId];
+	SearchThreadData& data = m_ThreadData[threadId];
+	counters.nodes++;
+
+	int ply = GetPly(node);
+	data.pvLength[ply] = ply;
+
+	const std::vector<Move>& legalMoves = TimedLegalMoves(board, threadId);
+	if (depth <= 0 or legalMoves.empty() or board.IsDraw()) {
+		node->score = Search(board, alpha, beta, depth, ply, threadId, false);
+		node->mate_in = MateDistance(node->score, ply);
 		return node->score;
 	}
 
-	node->bestChild = nullptr;
+	// the children are created once, in the order they should be searched
+	if (node->children.empty()) {
+		std::vector<Move> moves = legalMoves;
+		OrderMoves(board, moves, ply, threadId);
+		for (const Move& move : moves)
+			node->children.push_back(std::make_unique<TreeNode>(move, not node->whiteTurn, node));
+	}
 
+	node->bestChild = nullptr;
 	node->score = StaticEvaluator::LOSS; // worst case scenario is that the child is a mate against us
-	for (const auto& move : board.GetLegalMoves()) {
-		// create a new node for the child
-		node->children.push_back(std::make_unique<TreeNode>(move, not node->whiteTurn, node));
-		TreeNode* child = node->children.back().get();
+	for (size_t i = firstChild; i < node->children.size(); i++) {
+		const auto& child = node->children[i];
+		B childBoard = board;
+		childBoard.ApplyMove(child->delta);
+		data.onPreviousPv[ply + 1] = data.onPreviousPv[ply] and ply < (int)data.previousPv.size() and
+									 child->delta == data.previousPv[ply];
 
 		// evaluate the child from the perspective of the current node
-		Score childScore = -EvaluateNode(node->children.back().get(), -beta, -alpha, depth - 1);
+		// only the first child gets the full window, the others just have to prove they are worse
+		Score childScore;
+		if (i == firstChild)
+			childScore = -Search(childBoard, -beta, -alpha, depth - 1, ply + 1, threadId, true);
+		else {
+			counters.nullWindowSearches++;
+			childScore = -Search(childBoard, -alpha - NULL_WINDOW, -alpha, depth - 1, ply + 1, threadId, true);
+			if (childScore > alpha and childScore < beta) {
+				counters.pvsResearches++;
+				childScore = -Search(childBoard, -beta, -alpha, depth - 1, ply + 1, threadId, true);
+			}
+		}
+		if (IsStopped())
+			return 0;
+		child->score = -childScore;
+		child->mate_in = MateDistance(child->score, ply + 1);
+		child->pv.assign(data.pv[ply + 1].begin() + ply + 1, data.pv[ply + 1].begin() + data.pvLength[ply + 1]);
+
 		// higher child score is better for current node
 		if (childScore > node->score) {
 			node->score = childScore;
-			node->bestChild = child;
+			node->bestChild = child.get();
+			if (not node->parent and firstChild == 0)
+				m_RootScore.store(node->score, std::memory_order_relaxed);
 		}
 		alpha = std::max(alpha, node->score);
-		if (alpha >= beta)
+		if (alpha >= beta) {
+			counters.cutoffs++;
+			if (i == firstChild)
+				counters.firstMoveCutoffs++;
 			break;
+		}
 	}
 
-	if (node->bestChild and node->bestChild->mate_in) {
-		node->mate_in = node->bestChild->mate_in.value() + 1;
-		// if the mate in value is even, it's a mate against us
-		if (node->mate_in.value() % 2 == 0)
-			node->score = StaticEvaluator::LOSS + (Score)node->mate_in.value();
-		else
-			node->score = StaticEvaluator::WIN - (Score)node->mate_in.value();
+	node->pv.clear();
+	if (node->bestChild) {
+		node->pv.push_back(node->bestChild->delta);
+		node->pv.insert(node->pv.end(), node->bestChild->pv.begin(), node->bestChild->pv.end());
 	}
-	else
-		node->mate_in = std::nullopt;
+	node->mate_in = MateDistance(node->score, ply);
 	return node->score;
 }
 
-int Engine::Randint(int a, int b) {
+template<BoardRepresentation B>
+Score BasicEngine<B>::Search(const B& board, Score alpha, Score beta, int depth, int ply, int threadId, bool allowNull) const {
+	if (depth <= 0)
+		return Quiescence(board, alpha, beta, ply, threadId);
+
+	ThreadSearchCounters& counters = m_ThreadCounters[threadId];
+	SearchThreadData& data = m_ThreadData[threadId];
+	counters.nodes++;
+	counters.selDepth = std::max(counters.selDepth, ply);
+	data.pvLength[ply] = ply;
+	// the score doesn't matter once stopped, every caller checks for it before using one
+	if (ShouldStop(counters))
+		return 0;
+	// nothing below a drawn bitbase ending can change its score
+	if (Bitbases::Probe(board) == Bitbases::Wdl::Draw)
+		return 0;
+
+	// only a node searched with an open window can end up on the principal variation
+	const bool pvNode = beta - alpha > NULL_WINDOW * 1.5f;
+	const Score originalAlpha = alpha;
+
+	// a deep enough entry answers for the node, otherwise it still knows the best move
+	TTEntry entry;
+	uint16_t ttMove = 0;
+	counters.ttProbes++;
+	if (m_TT->Probe(board.GetHash(), entry)) {
+		counters.ttHits++;
+		ttMove = entry.move;
+		Score ttScore = FromTTScore(entry.score, ply);
+		if (not pvNode and entry.depth >= depth and
+			(entry.GetBound() == Bound::Exact or
+			 (entry.GetBound() == Bound::Lower and ttScore >= beta) or
+			 (entry.GetBound() == Bound::Upper and ttScore <= alpha)))
+			return ttScore;
+	}
+
+	const std::vector<Move>& legalMoves = TimedLegalMoves(board, threadId);
+	const bool inCheck = board.IsCheck();
+	if (legalMoves.empty())
+		return inCheck ? StaticEvaluator::LOSS + (Score)ply : 0;
+	if (board.IsDraw())
+		return 0;
+	if (ply >= MAX_PLY - 1)
+		return TimedEvaluate(board, threadId);
+
+	const Score staticEval = inCheck ? StaticEvaluator::LOSS : TimedEvaluate(board, threadId);
+
+	if (not pvNode and not inCheck and std::abs(beta) < MATE_BOUND) {
+		// the position is so good that a quiet move won't bring it back under beta
+		if (m_SearchOptions.reverseFutility and depth <= REVERSE_FUTILITY_DEPTH and
+			staticEval - REVERSE_FUTILITY_MARGIN * (Score)depth >= beta) {
+			counters.reverseFutilityPrunes++;
+			return staticEval;
+		}
+
+		// the position is so bad that only captures can save it, so only look at those
+		if (m_SearchOptions.razoring and depth < (int)RAZOR_MARGIN.size() and staticEval + RAZOR_MARGIN[depth] < alpha) {
+			Score score = Quiescence(board, alpha, alpha + NULL_WINDOW, ply, threadId);
+			if (score <= alpha) {
+				counters.razorPrunes++;
+				return score;
+			}
+		}
+
+		// give the opponent a free move, if we are still above beta a real move would be too
+		// zugzwang is where this fails, so never with only pawns left, never twice in a row and verified when deep
+		if (m_SearchOptions.nullMove and allowNull and depth >= NULL_MOVE_DEPTH and staticEval >= beta and
+			board.HasNonPawnMaterial(board.GetCurrentPlayer())) {
+			int reduction = 3 + depth / 6 + std::min(2, (int)((staticEval - beta) / 2));
+			B nullBoard = board;
+			nullBoard.ApplyNullMove();
+			data.onPreviousPv[ply + 1] = false;
+
+			counters.nullMoveTries++;
+			Score score = -Search(nullBoard, -beta, -beta + NULL_WINDOW, depth - 1 - reduction, ply + 1, threadId, false);
+			if (IsStopped())
+				return 0;
+			if (score >= beta) {
+				// a mate found after passing is not a real one
+				if (score >= MATE_BOUND)
+					score = beta;
+				if (depth < NULL_MOVE_VERIFICATION_DEPTH or
+					Search(board, beta - NULL_WINDOW, beta, depth - reduction, ply, threadId, false) >= beta) {
+					counters.nullMoveCutoffs++;
+					return score;
+				}
+			}
+		}
+	}
+
+	// near the leaves, quiet moves can't bring a lost position back to alpha
+	const bool futile = m_SearchOptions.futility and not pvNode and not inCheck and
+						depth < (int)FUTILITY_MARGIN.size() and std::abs(alpha) < MATE_BOUND and
+						staticEval + FUTILITY_MARGIN[depth] <= alpha;
+
+	std::vector<Move> moves = legalMoves;
+	OrderMoves(board, moves, ply, threadId, ttMove);
+
+	std::vector<Move> triedQuiets;
+	Score best = StaticEvaluator::LOSS;
+	const Move* bestMove = nullptr;
+	int searched = 0;
+	for (const Move& move : moves) {
+		const bool quiet = not move.promote and not board.IsCapture(move);
+		B child = board;
+		child.ApplyMove(move);
+		data.onPreviousPv[ply + 1] = data.onPreviousPv[ply] and ply < (int)data.previousPv.size() and move == data.previousPv[ply];
+		const bool givesCheck = child.IsCheck();
+
+		if (futile and quiet and not givesCheck and searched > 0) {
+			counters.futilityPrunes++;
+			continue;
+		}
+
+		// moves that give away material for nothing, quiet ones onto an attacked square or captures of a defended piece
+		if (m_SearchOptions.seePruning and not pvNode and not inCheck and not givesCheck and searched > 0 and
+			depth <= SEE_PRUNING_DEPTH and best > -MATE_BOUND and
+			board.StaticExchange(move) < -(quiet ? SEE_QUIET_MARGIN * depth : SEE_CAPTURE_MARGIN * depth * depth)) {
+			counters.seePrunes++;
+			continue;
+		}
+
+		Score score;
+		int reduction = 0;
+		// late quiet moves are unlikely to be good, search them shallower unless their history says otherwise
+		if (m_SearchOptions.lateMoveReductions and depth >= LATE_MOVE_DEPTH and searched >= (pvNode ? 3 : 2) and
+			quiet and not inCheck and not givesCheck) {
+			int history = data.history[static_cast<int>(board.GetCurrentPlayer())][SquareIndex(move.from)][SquareIndex(move.to)];
+			reduction = LATE_MOVE_REDUCTIONS[std::min(depth, MAX_PLY - 1)][std::min(searched, MAX_PLY - 1)];
+			reduction += pvNode ? 0 : 1;
+			reduction -= history * 2 / MAX_HISTORY;
+			reduction = std::clamp(reduction, 0, depth - 2);
+		}
+
+		// pvs: the first move gets the full window, the others a null window, reduced if they are late
+		// and a re-search when they turn out better than expected
+		if (searched == 0)
+			score = -Search(child, -beta, -alpha, depth - 1, ply + 1, threadId, true);
+		else {
+			if (reduction > 0)
+				counters.lateMoveReductions++;
+			counters.nullWindowSearches++;
+			score = -Search(child, -alpha - NULL_WINDOW, -alpha, depth - 1 - reduction, ply + 1, threadId, true);
+			if (score > alpha and reduction > 0) {
+				counters.lateMoveResearches++;
+				score = -Search(child, -alpha - NULL_WINDOW, -alpha, depth - 1, ply + 1, threadId, true);
+			}
+			if (score > alpha and score < beta) {
+				counters.pvsResearches++;
+				score = -Search(child, -beta, -alpha, depth - 1, ply + 1, threadId, true);
+			}
+		}
+		searched++;
+		if (IsStopped())
+			return 0;
+
+		if (score > best) {
+			best = score;
+			bestMove = &move;
+			if (score > alpha) {
+				alpha = score;
+				data.pv[ply][ply] = move;
+				for (int i = ply + 1; i < data.pvLength[ply + 1]; i++)
+					data.pv[ply][i] = data.pv[ply + 1][i];
+				data.pvLength[ply] = std::max(ply + 1, data.pvLength[ply + 1]);
+			}
+		}
+		if (alpha >= beta) {
+			counters.cutoffs++;
+			if (searched == 1)
+				counters.firstMoveCutoffs++;
+			if (quiet)
+				UpdateQuietHistory(board, move, ply, depth, threadId, triedQuiets);
+			break;
+		}
+		if (quiet)
+			triedQuiets.push_back(move);
+	}
+
+	Bound bound = best >= beta ? Bound::Lower : best > originalAlpha ? Bound::Exact : Bound::Upper;
+	m_TT->Store(board.GetHash(), ToTTScore(best, ply), depth, bound,
+			   bestMove and bound != Bound::Upper ? TranspositionTable::PackMove(*bestMove) : 0);
+	return best;
+}
+
+template<BoardRepresentation B>
+Score BasicEngine<B>::Quiescence(const B& board, Score alpha, Score beta, int ply, int threadId) const {
+	PERF_PHASE(SearchPhase::Quiescence);
+	ThreadSearchCounters& counters = m_ThreadCounters[threadId];
+	SearchThreadData& data = m_ThreadData[threadId];
+	counters.nodes++;
+	counters.qNodes++;
+	counters.selDepth = std::max(counters.selDepth, ply);
+	data.pvLength[ply] = ply;
+	if (ShouldStop(counters))
+		return 0;
+
+	const bool pvNode = beta - alpha > NULL_WINDOW * 1.5f;
+	const Score originalAlpha = alpha;
+	TTEntry entry;
+	uint16_t ttMove = 0;
+	counters.ttProbes++;
+	if (m_TT->Probe(board.GetHash(), entry)) {
+		counters.ttHits++;
+		ttMove = entry.move;
+		Score ttScore = FromTTScore(entry.score, ply);
+		if (not pvNode and
+			(entry.GetBound() == Bound::Exact or
+			 (entry.GetBound() == Bound::Lower and ttScore >= beta) or
+			 (entry.GetBound() == Bound::Upper and ttScore <= alpha)))
+			return ttScore;
+	}
+
+	const std::vector<Move>& legalMoves = TimedLegalMoves(board, threadId);
+	const bool inCheck = board.IsCheck();
+	if (legalMoves.empty())
+		return inCheck ? StaticEvaluator::LOSS + (Score)ply : 0;
+	if (ply >= MAX_PLY - 1)
+		return TimedEvaluate(board, threadId);
+
+	// standing pat, the side to move doesn't have to take anything unless it is in check
+	Score best = StaticEvaluator::LOSS + (Score)ply;
+	if (not inCheck) {
+		best = TimedEvaluate(board, threadId);
+		if (best >= beta)
+			return best;
+		alpha = std::max(alpha, best);
+	}
+
+	// captures that lose material in the exchange can't raise the score above standing pat
+	std::vector<Move> moves;
+	for (const Move& move : legalMoves) {
+		if (inCheck)
+			moves.push_back(move);
+		else if (move.promote or board.IsCapture(move)) {
+			if (m_SearchOptions.seePruning and LosesExchange(board, move))
+				counters.seePrunes++;
+			else
+				moves.push_back(move);
+		}
+	}
+	OrderMoves(board, moves, ply, threadId, ttMove);
+	const Move* bestMove = nullptr;
+
+	for (const Move& move : moves) {
+		B child = board;
+		child.ApplyMove(move);
+		data.onPreviousPv[ply + 1] = data.onPreviousPv[ply] and ply < (int)data.previousPv.size() and move == data.previousPv[ply];
+		Score score = -Quiescence(child, -beta, -alpha, ply + 1, threadId);
+		if (IsStopped())
+			return 0;
+
+		if (score > best) {
+			best = score;
+			bestMove = &move;
+			if (score > alpha) {
+				alpha = score;
+				data.pv[ply][ply] = move;
+				for (int i = ply + 1; i < data.pvLength[ply + 1]; i++)
+					data.pv[ply][i] = data.pv[ply + 1][i];
+				data.pvLength[ply] = std::max(ply + 1, data.pvLength[ply + 1]);
+			}
+		}
+		if (alpha >= beta) {
+			counters.cutoffs++;
+			if (move == moves.front())
+				counters.firstMoveCutoffs++;
+			break;
+		}
+	}
+
+	Bound bound = best >= beta ? Bound::Lower : best > originalAlpha ? Bound::Exact : Bound::Upper;
+	m_TT->Store(board.GetHash(), ToTTScore(best, ply), 0, bound,
+			   bestMove and bound != Bound::Upper ? TranspositionTable::PackMove(*bestMove) : 0);
+	return best;
+}
+
+template<BoardRepresentation B>
+Score BasicEngine<B>::TimedEvaluate(const B& board, int threadId) const {
+	uint64_t start = Timer::ReadTicks();
+	Score score = StaticEvaluator::Evaluate(board);
+	m_ThreadCounters[threadId].evalTicks += Timer::ReadTicks() - start;
+	return score;
+}
+
+template<BoardRepresentation B>
+const std::vector<Move>& BasicEngine<B>::TimedLegalMoves(const B& board, int threadId) const {
+	uint64_t start = Timer::ReadTicks();
+	const std::vector<Move>& moves = board.GetLegalMoves();
+	m_ThreadCounters[threadId].moveGenTicks += Timer::ReadTicks() - start;
+	return moves;
+}
+
+// captures by the value of what they take and then of what takes, then the killers and the quiet moves by history
+// and last the captures that lose material
+template<BoardRepresentation B>
+void BasicEngine<B>::OrderMoves(const B& board, std::vector<Move>& moves, int ply, int threadId, uint16_t ttMove) const {
+	const SearchThreadData& data = m_ThreadData[threadId];
+	const auto& history = data.history[static_cast<int>(board.GetCurrentPlayer())];
+
+	std::vector<std::pair<int, Move>> scored;
+	scored.reserve(moves.size());
+	for (const Move& move : moves) {
+		int score;
+		if (ttMove and TranspositionTable::PackMove(move) == ttMove)
+			score = 5 * MAX_HISTORY;
+		else if (data.onPreviousPv[ply] and ply < (int)data.previousPv.size() and move == data.previousPv[ply])
+			score = 4 * MAX_HISTORY;
+		else if (board.IsCapture(move) or move.promote) {
+			char victim = board.GetPiece(move.to);
+			Score gain = (victim == ' ' ? (move.promote ? 0 : 1) : StaticEvaluator::PieceValue(victim)) +
+						 (move.promote ? StaticEvaluator::PieceValue(move.promote.value()) : 0);
+			score = 3 * MAX_HISTORY + (int)(gain * 100) - (int)StaticEvaluator::PieceValue(board.GetPiece(move.from));
+			if (LosesExchange(board, move))
+				score -= 5 * MAX_HISTORY;
+		}
+		else if (ply < MAX_PLY and move == data.killers[ply][0])
+			score = 2 * MAX_HISTORY + 1;
+		else if (ply < MAX_PLY and move == data.killers[ply][1])
+			score = 2 * MAX_HISTORY;
+		else
+			score = history[SquareIndex(move.from)][SquareIndex(move.to)];
+		scored.emplace_back(score, move);
+	}
+
+	std::stable_sort(scored.begin(), scored.end(), [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+	for (size_t i = 0; i < scored.size(); i++)
+		moves[i] = scored[i].second;
+}
+
+// taking something worth at least the piece that takes can't lose material, only the other captures are played out
+template<BoardRepresentation B>
+bool BasicEngine<B>::LosesExchange(const B& board, const Move& move) {
+	char piece = board.GetPiece(move.from);
+	if (not move.promote and board.GetPiece(move.to) != ' ' and
+		StaticEvaluator::PieceValue(board.GetPiece(move.to)) >= StaticEvaluator::PieceValue(piece) and
+		piece != 'K' and piece != 'k')
+		return false;
+	return board.StaticExchange(move) < 0;
+}
+
+// rewards the quiet move that caused a cutoff and punishes the ones tried before it
+template<BoardRepresentation B>
+void BasicEngine<B>::UpdateQuietHistory(const B& board, const Move& move, int ply, int depth, int threadId,
+								const std::vector<Move>& triedQuiets) const {
+	SearchThreadData& data = m_ThreadData[threadId];
+	auto& history = data.history[static_cast<int>(board.GetCurrentPlayer())];
+
+	if (not (move == data.killers[ply][0])) {
+		data.killers[ply][1] = data.killers[ply][0];
+		data.killers[ply][0] = move;
+	}
+
+	// the bonus shrinks as the entry gets closer to the maximum so it stays in [-MAX_HISTORY, MAX_HISTORY]
+	int bonus = std::min(depth * depth, MAX_HISTORY / 4);
+	auto update = [&](const Move& quiet, int amount) {
+		int& entry = history[SquareIndex(quiet.from)][SquareIndex(quiet.to)];
+		entry += amount - entry * std::abs(amount) / MAX_HISTORY;
+	};
+	update(move, bonus);
+	for (const Move& quiet : triedQuiets)
+		update(quiet, -bonus);
+}
+
+// mate scores are stored relative to the node so they stay right when the node is reached at another ply
+template<BoardRepresentation B>
+Score BasicEngine<B>::ToTTScore(Score score, int ply) {
+	if (score >= MATE_BOUND)
+		return score + (Score)ply;
+	if (score <= -MATE_BOUND)
+		return score - (Score)ply;
+	return score;
+}
+
+template<BoardRepresentation B>
+Score BasicEngine<B>::FromTTScore(Score score, int ply) {
+	if (score >= MATE_BOUND)
+		return score - (Score)ply;
+	if (score <= -MATE_BOUND)
+		return score + (Score)ply;
+	return score;
+}
+
+// puts the lines on the root and its children, best first
+// the root describes the best line again, the last multipv pass or an interrupted iteration left it elsewhere
+template<BoardRepresentation B>
+void BasicEngine<B>::SetRootLines(const std::vector<AnalysisLine>& lines) {
+	if (lines.empty())
+		return;
+
+	auto& children = m_Tree->children;
+	for (size_t i = 0; i < lines.size(); i++) {
+		auto it = std::find_if(children.begin() + (long)i, children.end(),
+							   [&](const auto& child) { return child->delta == lines[i].move; });
+		if (it == children.end())
+			continue;
+		std::rotate(children.begin() + (long)i, it, it + 1);
+
+		TreeNode* child = children[i].get();
+		child->score = -lines[i].score;
+		child->mate_in = MateDistance(child->score, 1);
+		child->pv.assign(lines[i].line.begin() + 1, lines[i].line.end());
+	}
+
+	m_Tree->bestChild = children.front().get();
+	m_Tree->score = lines.front().score;
+	m_Tree->pv = lines.front().line;
+	m_Tree->mate_in = MateDistance(m_Tree->score, 0);
+}
+
+// the child is mated in an even number of plies, the root player in an odd one
+template<BoardRepresentation B>
+std::optional<int> BasicEngine<B>::MateInMoves(const TreeNode* child) const {
+	if (not child->mate_in)
+		return std::nullopt;
+	int plies = child->mate_in.value();
+	bool rootMates = plies % 2 == 0;
+	int moves = rootMates ? plies / 2 + 1 : (plies + 1) / 2;
+	return rootMates == m_Tree->whiteTurn ? moves : -moves;
+}
+
+template<BoardRepresentation B>
+std::optional<int> BasicEngine<B>::MateDistance(Score score, int ply) {
+	if (std::abs(score) < MATE_BOUND)
+		return std::nullopt;
+	return (int)std::lround(StaticEvaluator::WIN - std::abs(score)) - ply;
+}
+
+template<BoardRepresentation B>
+int BasicEngine<B>::Randint(int a, int b) {
 	std::random_device dev;
 	std::mt19937 rng(dev());
 	std::uniform_int_distribution<std::mt19937::result_type> dist6(a, b); // distribution in range [a, b]
@@ -266,22 +1120,25 @@ int Engine::Randint(int a, int b) {
 	return (int)dist6(rng);
 }
 
-std::string Engine::ScoreLabel(Score score, std::optional<int> mate_in, bool whiteTurn) {
+template<BoardRepresentation B>
+std::string BasicEngine<B>::ScoreLabel(Score score, std::optional<int> mate_in, bool whiteTurn) {
 	std::stringstream ss;
 	// set the precision to 2 decimal places
 	ss << std::fixed << std::setprecision(2);
 
+	// the label is for the line leading to the node, so the move into it is counted
 	if (mate_in) {
+		int moves = score < 0 ? mate_in.value() / 2 + 1 : (mate_in.value() + 1) / 2;
 		// if white will win
 		if (score > 0 and whiteTurn or
 								   score < 0 and not whiteTurn) {
-			ss << "# " << mate_in.value() + 1;
+			ss << "# " << moves;
 			return ss.str();
 		}
 		// if black will win
 		if (score < 0 and whiteTurn or
 									score > 0 and not whiteTurn) {
-			ss << "#-" << mate_in.value() + 1;
+			ss << "#-" << moves;
 			return ss.str();
 		}
 	}
@@ -303,4 +1160,7 @@ std::string Engine::ScoreLabel(Score score, std::optional<int> mate_in, bool whi
 	else
 		ss << " 0.00";
 	return ss.str();
-}
\ No newline at end of file
+}
+
+// the board representations the engine is built for
+template class BasicEngine<Board>;
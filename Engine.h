@@ -1,5 +1,11 @@
+#pragma once
 #include "Chess.h"
 #include "StaticEvaluator.h"
+#include "SearchStats.h"
+#include "TranspositionTable.h"
+#include "ThreadPool.h"
+#include "MateSolver.h"
+#include "Book.h"
 
 struct TreeNode {
 	Move delta;
@@ -10,6 +16,12 @@ struct TreeNode {
 	TreeNode* parent = nullptr;
 	TreeNode* bestChild = nullptr;
 	std::vector<std::unique_ptr<TreeNode>> children;
+	// the search below the tree doesn't create nodes, the best line it found is stored here
+	std::vector<Move> pv;
+	// how deep the node was searched, for the nodes of the thinking frontier, 0 until it is
+	int depth = 0;
+	// a frontier node is only ever searched by one thread at a time
+	bool searching = false;
 
 	// if we have calculated the board for this node,
 	// we can store the fen here to index the cache
@@ -27,20 +39,108 @@ bool operator<(const TreeNode& lhs, const TreeNode& rhs);
 struct MoveReturnData {
 	Move move;
 	Score score = 0;
+	// moves until mate, positive if white mates
 	std::optional<int> mate_in;
 };
 
-class Engine {
-public:
-	explicit Engine(Chess& c);
+// one of the best moves of a multipv search
+struct AnalysisLine {
+	Move move;
+	// from the perspective of the player to move at the root
+	Score score = 0;
+	// moves until mate, positive if white mates
+	std::optional<int> mate_in;
+	std::vector<Move> line;
+};
 
+constexpr int MAX_PLY = 64;
+
+// called after every completed iteration with its depth, best lines and the nodes searched so far
+typedef std::function<void(int depth, const std::vector<AnalysisLine>& lines, uint64_t nodes)> IterationCallback;
+
+// how the search is run, each of the selective parts can be turned off to measure how much it shrinks the tree
+struct SearchOptions {
+	// how many of the best root moves get an exact score and line
+	int multiPV = 1;
+	bool nullMove = true;
+	bool lateMoveReductions = true;
+	bool reverseFutility = true;
+	bool futility = true;
+	bool razoring = true;
+	// skips the moves that lose material in the exchange on their square, in quiescence and near the leaves
+	bool seePruning = true;
+	// a mate solver looks for a forced mate in at most this many moves next to the search, and stops it when it finds one
+	// it needs a core of its own, so it is off unless asked for, most callers already have a search on every core
+	int mateSearchMoves = 0;
+};
+
+// move ordering and pv state of a search thread, kept between the nodes it searches
+struct SearchThreadData {
+	// two quiet moves per ply that caused a beta cutoff
+	std::array<std::array<Move, 2>, MAX_PLY> killers{};
+	// how well a quiet move did in cutoffs, indexed by [Player][from][to]
+	std::array<std::array<std::array<int, 64>, 64>, 2> history{};
+	// triangular pv table, pv[ply] holds the best line from ply, up to pvLength[ply]
+	std::array<std::array<Move, MAX_PLY>, MAX_PLY> pv{};
+	std::array<int, MAX_PLY> pvLength{};
+	// the pv of the last iteration, its moves are searched first while the search is still following it
+	std::vector<Move> previousPv;
+	std::array<bool, MAX_PLY> onPreviousPv{};
+};
+
+// the search, built for each board representation without any virtual call
+template<BoardRepresentation B>
+class BasicEngine {
+public:
+	// the engine has a pool of its own with that many threads, they search while it thinks and clear or load its table
+	// GetBestMove searches on the calling thread either way
+	explicit BasicEngine(BasicChess<B>& c, size_t threads = 1);
+	// the threads of a pool shared with other engines instead, it has to outlive the engine
+	BasicEngine(BasicChess<B>& c, ThreadPool& pool);
+	~BasicEngine();
+
+	// searches the position in the background on the pool until StopThinking
+	// nothing else may be called on the engine in between
 	void Think();
 	void StopThinking();
 	void ApplyMove(const Move& move);
+	// the game is replaced by one from the position, the hash table and the move ordering history are kept
+	void SetPosition(const std::string& fen);
 	void ApplyThinkingPolicy();
+	// asks the running search to return as soon as possible, safe to call from any thread
+	void Stop();
+	void SetDepth(int depth) { m_BatchDepth = depth; }
+	// the searches deepen until a search thread has searched this many nodes instead of stopping at the depth, 0 for no limit
+	void SetNodeLimit(uint64_t nodes) { m_NodeLimit = nodes; }
+	void SetThinkTime(int ms) { m_msThinkTime = ms; }
+	void SetHashSize(size_t megabytes);
+	void ClearHash();
+	// with ClearHash, the next search is the one of a new engine
+	void ClearHistory();
+	// the table of an earlier process, see TranspositionTable::Load, false if the file can't be used
+	bool LoadHash(const std::string& path, bool shared = false);
+	void SaveHash(const std::string& path) const;
+	// the engine probes and stores in the table of another instead of its own, several engines can share one
+	// the table has to outlive the engine, and it can't be resized or cleared while any of them searches
+	void ShareHash(TranspositionTable& table) { m_TT = &table; }
+	[[nodiscard]] const TranspositionTable& GetTranspositionTable() const { return *m_TT; }
+	[[nodiscard]] SearchOptions& GetSearchOptions() { return m_SearchOptions; }
 
 	[[nodiscard]] MoveReturnData GetBestMove();
 
+	// every finished search is written as a json line to the writer, if there is one
+	void SetStatsWriter(StatsWriter* writer) { m_StatsWriter = writer; }
+	// called from the thread running GetBestMove
+	void SetIterationCallback(IterationCallback callback) { m_IterationCallback = std::move(callback); }
+	// the moves the book has are played without a search, it has to outlive the engine
+	void SetBook(const Book::Reader* book) { m_Book = book; }
+	// a quiet engine prints neither the progress bar nor the lines and stats of its searches or its thinking,
+	// so several can search at once
+	void SetVerbose(bool verbose) { m_Verbose = verbose; }
+	[[nodiscard]] const SearchStats& GetLastStats() const { return m_LastStats; }
+	// the best lines of the last search, best first, as many as SearchOptions::multiPV asks for
+	[[nodiscard]] const std::vector<AnalysisLine>& GetLines() const { return m_Lines; }
+
 	static std::vector<Move> GetLine(TreeNode* node);
 	static std::string LineToString(const std::vector<Move>& line) ;
 	[[nodiscard]] static std::string ScoreLabel(const TreeNode* node) {
@@ -48,32 +148,103 @@ public:
 	}
 	[[nodiscard]] static std::string ScoreLabel(Score score, std::optional<int> mate_in, bool whiteTurn);
 private:
+	BasicEngine(BasicChess<B>& c, std::unique_ptr<ThreadPool> ownPool, ThreadPool* sharedPool);
 
 	static int Randint(int a, int b);
+	// searches a frontier node to the depth and backs its score up the tree
 	void ExpandNode(TreeNode* node, int depth, int threadId);
-	Score EvaluateNode(TreeNode* node, Score alpha, Score beta, int depth) const;
-
-	void ThreadWorker(int threadId);
-	static void LoadingBar(const std::stop_token& st, const Score* score);
-	[[nodiscard]] Board GetBoardFromNode(TreeNode* node) const;
-	void ClearQueue();
-	void AddToQueue(TreeNode* node);
-
-	void AddManyToQueue(const std::vector<std::unique_ptr<TreeNode>>::iterator& begin,
-						const std::vector<std::unique_ptr<TreeNode>>::iterator& end);
-
-	Chess& m_Chess;
-
-	static const int n_Threads = 1;
-	std::array<std::thread, n_Threads> m_Threads;
-	std::mutex m_QueueMutex;
-	std::condition_variable m_QueueCondition;
-	std::queue<TreeNode*> m_Queue;
-	std::atomic_bool m_Thinking = true;
-
-	const int m_BatchDepth = 6;
+	// the score, line and depth of the node from its searched children
+	void BackUp(TreeNode* node);
+	// queues the most promising frontier nodes until every thread has enough work, with m_TreeMutex held
+	void ScheduleFrontier();
+	[[nodiscard]] float FrontierPriority(const TreeNode* node) const;
+	[[nodiscard]] static int GetPly(const TreeNode* node);
+	// the children before firstChild are skipped, they were already found by an earlier multipv pass
+	Score EvaluateNode(TreeNode* node, Score alpha, Score beta, int depth, int threadId, size_t firstChild = 0) const;
+	// searches below the tree, the board is copied for every move instead of creating nodes
+	Score Search(const B& board, Score alpha, Score beta, int depth, int ply, int threadId, bool allowNull) const;
+	// only captures and promotions are searched until the position is quiet
+	Score Quiescence(const B& board, Score alpha, Score beta, int ply, int threadId) const;
+	Score TimedEvaluate(const B& board, int threadId) const;
+	const std::vector<Move>& TimedLegalMoves(const B& board, int threadId) const;
+	// sorts the moves from the most to the least promising
+	void OrderMoves(const B& board, std::vector<Move>& moves, int ply, int threadId, uint16_t ttMove = 0) const;
+	// does the capture or promotion give away more than it takes once the exchange on its square is played out
+	[[nodiscard]] static bool LosesExchange(const B& board, const Move& move);
+	void UpdateQuietHistory(const B& board, const Move& move, int ply, int depth, int threadId,
+							const std::vector<Move>& triedQuiets) const;
+	// the number of plies from the node to the mate, if the score is a mate score
+	[[nodiscard]] static std::optional<int> MateDistance(Score score, int ply);
+	[[nodiscard]] std::optional<int> MateInMoves(const TreeNode* child) const;
+	void SetRootLines(const std::vector<AnalysisLine>& lines);
+	[[nodiscard]] bool ShouldStop(const ThreadSearchCounters& counters) const;
+	[[nodiscard]] bool IsStopped() const;
+	[[nodiscard]] static Score ToTTScore(Score score, int ply);
+	[[nodiscard]] static Score FromTTScore(Score score, int ply);
+
+	static void LoadingBar(const std::stop_token& st, const std::atomic<Score>* score);
+	[[nodiscard]] B GetBoardFromNode(TreeNode* node) const;
+	// queues the expansion of the node on the pool
+	void AddToQueue(TreeNode* node, int depth);
+
+	BasicChess<B>& m_Chess;
+
+	std::atomic_bool m_Thinking = false;
+
+	int m_BatchDepth = 6;
 	int m_msThinkTime = 1000;
+	// set by ApplyThinkingPolicy for the next search only
+	std::chrono::steady_clock::time_point m_Deadline;
+	bool m_HasDeadline = false;
+	uint64_t m_NodeLimit = 0;
+	mutable std::atomic_bool m_Stop = false;
+	// false until the first root search is done, so that there is always a move to return
+	bool m_CanStop = false;
 	std::unique_ptr<TreeNode> m_Tree = nullptr;
+	// the nodes searched by the pool while thinking, the tree above them is only updated with m_TreeMutex held
+	std::vector<TreeNode*> m_Frontier;
+	int m_FrontierJobs = 0;
+	std::mutex m_TreeMutex;
+	std::chrono::steady_clock::time_point m_ThinkStart;
+
+	SearchOptions m_SearchOptions;
+	// only ever used by the thread running next to GetBestMove
+	BasicMateSolver<B> m_MateSolver;
+	// one per thread of the pool, the one running GetBestMove uses the first
+	mutable std::vector<ThreadSearchCounters> m_ThreadCounters;
+	mutable std::vector<SearchThreadData> m_ThreadData;
+	TranspositionTable m_OwnTT;
+	// the own table unless the engine shares one
+	TranspositionTable* m_TT = &m_OwnTT;
+	// score of the root published for the loading bar, the tree itself is not safe to read while searching
+	mutable std::atomic<Score> m_RootScore = 0;
+
+	SearchStats m_LastStats;
+	std::vector<AnalysisLine> m_Lines;
+	StatsWriter* m_StatsWriter = nullptr;
+	const Book::Reader* m_Book = nullptr;
+	IterationCallback m_IterationCallback;
+	bool m_Verbose = true;
+
+	// created once for the lifetime of the engine, last so that its workers are joined before anything they use dies
+	std::unique_ptr<ThreadPool> m_OwnPool;
+	// the own pool unless the engine shares one
+	ThreadPool* m_Pool;
+	// the expansions queued while thinking, waited on apart from the other tasks of the pool
+	ThreadPool::Batch m_ThinkTasks{*m_Pool};
+};
+
+typedef BasicEngine<Board> Engine;
 
-	mutable std::array<int, n_Threads> m_NodesPerThread = {0};
-};
\ No newline at end of file
+// an engine and its game, for the tools that search positions on several threads at once, one worker per thread
+// the engines share the pool and search on the threads of their workers, quiet so their output doesn't interleave
+struct SearchWorker {
+	SearchWorker(size_t hashMegabytes, ThreadPool& pool)
+		: engine(chess, pool) {
+		engine.SetHashSize(hashMegabytes);
+		engine.SetVerbose(false);
+	}
+
+	Chess chess;
+	Engine engine;
+};
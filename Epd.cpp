@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "Epd.h"
+#include "Pgn.h"
+#include "Bitbases.h"
+#include "ThreadPool.h"
+
+#include <fstream>
+
+namespace Epd {
+	namespace {
+		std::string_view Trim(std::string_view text) {
+			while (not text.empty() and std::isspace((unsigned char)text.front()))
+				text.remove_prefix(1);
+			while (not text.empty() and std::isspace((unsigned char)text.back()))
+				text.remove_suffix(1);
+			return text;
+		}
+
+		// the next word of the text, the text is left after it
+		std::string_view NextWord(std::string_view& text) {
+			text = Trim(text);
+			size_t end = std::min(text.find_first_of(" \t"), text.size());
+			std::string_view word = text.substr(0, end);
+			text.remove_prefix(end);
+			return word;
+		}
+
+		bool IsNumber(std::string_view word) {
+			return not word.empty() and std::ranges::all_of(word, [](char c) { return std::isdigit((unsigned char)c); });
+		}
+
+		Result Solve(SearchWorker& worker, const Position& position, const Options& options) {
+			Engine& engine = worker.engine;
+			// nothing is left from the positions the worker searched before
+			engine.SetPosition(position.fen);
+			engine.ClearHash();
+			engine.ClearHistory();
+			if (options.nodes > 0)
+				engine.SetNodeLimit(options.nodes);
+			else {
+				engine.SetThinkTime(options.moveTimeMs);
+				engine.ApplyThinkingPolicy();
+			}
+
+			Result result;
+			result.id = position.id;
+			// the first iteration of the ones that all found a right move
+			std::optional<Result> found;
+			auto start = std::chrono::steady_clock::now();
+			engine.SetIterationCallback([&](int depth, const std::vector<AnalysisLine>& lines, uint64_t nodes) {
+				if (lines.empty() or not position.IsSolvedBy(lines.front().move))
+					found.reset();
+				else if (not found) {
+					found = Result();
+					found->solutionMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+					found->solutionNodes = nodes;
+					found->solutionDepth = depth;
+				}
+			});
+
+			MoveReturnData data = engine.GetBestMove();
+			const SearchStats& stats = engine.GetLastStats();
+			result.move = data.move;
+			result.timeMs = stats.timeMs;
+			result.nodes = stats.nodes;
+			result.solved = position.IsSolvedBy(data.move);
+			if (result.solved) {
+				// the move only came with the stopped iteration
+				result.solutionMs = found ? found->solutionMs : stats.timeMs;
+				result.solutionNodes = found ? found->solutionNodes : stats.nodes;
+				result.solutionDepth = found ? found->solutionDepth : stats.depth;
+			}
+			return result;
+		}
+	}
+
+	bool Position::IsSolvedBy(const Move& move) const {
+		if (std::ranges::find(avoidMoves, move) != avoidMoves.end())
+			return false;
+		return bestMoves.empty() or std::ranges::find(bestMoves, move) != bestMoves.end();
+	}
+
+	std::optional<Position> Parse(std::string_view line) {
+		std::string fen;
+		for (int field = 0; field < 4; field++) {
+			std::string_view word = NextWord(line);
+			if (word.empty())
+				return std::nullopt;
+			fen += std::string(word) + " ";
+		}
+		// the move counters are only there if the position is a whole fen
+		std::string_view rest = line;
+		std::string_view halfMoves = NextWord(rest);
+		std::string_view fullMoves = NextWord(rest);
+		if (IsNumber(halfMoves) and IsNumber(fullMoves)) {
+			fen += std::string(halfMoves) + " " + std::string(fullMoves);
+			line = rest;
+		}
+		else
+			fen += "0 1";
+
+		Position position;
+		position.fen = fen;
+		std::optional<Board> parsed;
+		try {
+			parsed.emplace(fen);
+		}
+		catch (const std::runtime_error&) {
+			return std::nullopt;
+		}
+		const Board& board = parsed.value();
+		const RawBoard& raw = board.GetRawBoard();
+		if (std::ranges::count(raw, 'K') != 1 or std::ranges::count(raw, 'k') != 1 or board.GetLegalMoves().empty())
+			return std::nullopt;
+
+		// the operations end with a semicolon, which may also be in a quoted operand
+		while (not Trim(line).empty()) {
+			line = Trim(line);
+			size_t end = 0;
+			for (bool quoted = false; end < line.size() and (quoted or line[end] != ';'); end++)
+				if (line[end] == '"')
+					quoted = not quoted;
+			std::string_view operation = line.substr(0, end);
+			line.remove_prefix(std::min(end + 1, line.size()));
+
+			std::string_view opcode = NextWord(operation);
+			std::string_view operands = Trim(operation);
+			if (opcode == "bm" or opcode == "am") {
+				std::vector<Move>& moves = opcode == "bm" ? position.bestMoves : position.avoidMoves;
+				for (std::string_view san; not (san = NextWord(operands)).empty();) {
+					std::optional<Move> move = Pgn::SanToMove(board, san);
+					if (not move)
+						return std::nullopt;
+					moves.push_back(move.value());
+				}
+			}
+			else if (opcode == "id") {
+				if (operands.size() >= 2 and operands.front() == '"' and operands.back() == '"')
+					operands = operands.substr(1, operands.size() - 2);
+				position.id = operands;
+			}
+		}
+		if (position.bestMoves.empty() and position.avoidMoves.empty())
+			return std::nullopt;
+		return position;
+	}
+
+	Report Run(const std::string& path, const Options& options) {
+		std::ifstream file(path);
+		if (not file)
+			throw std::runtime_error("could not read " + path);
+		Report report;
+		std::vector<Position> positions;
+		for (std::string line; std::getline(file, line);) {
+			if (Trim(line).empty())
+				continue;
+			if (std::optional<Position> position = Parse(line)) {
+				if (position->id.empty())
+					position->id = std::to_string(positions.size() + 1);
+				positions.push_back(std::move(position.value()));
+			}
+			else
+				report.skipped++;
+		}
+
+		size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+		// the engines search on the threads of the workers, they share the pool for the bitbases and clearing their tables
+		// the bitbases are built before the first position, so they aren't part of its time
+		ThreadPool pool(threads);
+		Bitbases::Init(&pool);
+		auto start = std::chrono::steady_clock::now();
+		report.results.resize(positions.size());
+		std::atomic<size_t> next = 0;
+		{
+			std::vector<std::jthread> workers;
+			for (size_t i = 0; i < std::min(threads, positions.size()); i++)
+				workers.emplace_back([&] {
+					SearchWorker worker(options.hashMegabytes, pool);
+					for (size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < positions.size();)
+						report.results[index] = Solve(worker, positions[index], options);
+				});
+		}
+		report.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		for (const Result& result : report.results)
+			if (result.solved) {
+				report.solved++;
+				report.averageSolutionMs += result.solutionMs;
+				report.averageSolutionNodes += (double)result.solutionNodes;
+			}
+		if (report.solved) {
+			report.averageSolutionMs /= (double)report.solved;
+			report.averageSolutionNodes /= (double)report.solved;
+		}
+		return report;
+	}
+}
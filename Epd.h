@@ -0,0 +1,60 @@
+#pragma once
+#include "Engine.h"
+
+// test suites in epd, positions with the moves the engine should find or avoid
+// https://www.chessprogramming.org/Extended_Position_Description
+namespace Epd {
+	struct Position {
+		std::string id;
+		std::string fen;
+		// the bm operation, any of them solves the position
+		std::vector<Move> bestMoves;
+		// the am operation, none of them may be played
+		std::vector<Move> avoidMoves;
+
+		[[nodiscard]] bool IsSolvedBy(const Move& move) const;
+	};
+
+	// the four fields of the position, or a whole fen, then the operations: bm Qg6 Rf8; am Bxh7; id "WAC.001";
+	// nullopt if the position can't be read, has neither bm nor am, or one of their moves isn't legal in it
+	[[nodiscard]] std::optional<Position> Parse(std::string_view line);
+
+	struct Options {
+		// every position is searched until then, unless there is a node budget
+		int moveTimeMs = 1000;
+		// every position is searched until then instead
+		uint64_t nodes = 0;
+		size_t hashMegabytes = 16;
+		// one worker per core if 0
+		size_t threads = 0;
+	};
+
+	struct Result {
+		std::string id;
+		Move move;
+		bool solved = false;
+		// when the iteration that found the move was done, the moves of all the iterations after it were right too
+		double solutionMs = 0;
+		uint64_t solutionNodes = 0;
+		int solutionDepth = 0;
+		double timeMs = 0;
+		uint64_t nodes = 0;
+	};
+
+	struct Report {
+		// in the order of the file
+		std::vector<Result> results;
+		// lines that aren't a position with bm or am
+		uint64_t skipped = 0;
+		uint64_t solved = 0;
+		// over the solved positions
+		double averageSolutionMs = 0;
+		double averageSolutionNodes = 0;
+		double timeMs = 0;
+	};
+
+	// every worker has an engine, its table and history are cleared before every position, so the result doesn't depend on the others
+	// the workers take the positions one after the other, so independent positions are searched in parallel
+	// throws std::runtime_error if the file can't be read
+	Report Run(const std::string& path, const Options& options = {});
+}
@@ -0,0 +1,195 @@
+#include "pch.h"
+#include "MateSolver.h"
+
+template<BoardRepresentation B>
+BasicMateSolver<B>::BasicMateSolver(size_t hashMegabytes) {
+	size_t entries = 1;
+	while (entries * 2 * sizeof(Entry) <= hashMegabytes * 1024 * 1024)
+		entries *= 2;
+	m_Table.resize(entries);
+	m_Mask = entries - 1;
+}
+
+template<BoardRepresentation B>
+MateResult BasicMateSolver<B>::FindMate(const B& board, int maxMoves, std::stop_token stopToken, uint64_t maxNodes) {
+	auto start = std::chrono::steady_clock::now();
+	m_StopToken = std::move(stopToken);
+	m_Nodes = 0;
+	m_MaxNodes = maxNodes;
+	m_Stopped = false;
+
+	// the attacker always moves at an odd number of plies left, so that it gives the last move
+	MateResult result;
+	for (int moves = 1; moves <= maxMoves; moves++) {
+		int plies = 2 * moves - 1;
+		Numbers numbers = GetNumbers(board, true, plies);
+		if (numbers.phi != 0 and numbers.delta != 0) {
+			Expand(board, true, plies, INFINITE - 1, INFINITE - 1);
+			numbers = GetNumbers(board, true, plies);
+		}
+
+		if (numbers.phi == 0) {
+			FillLine(board, true, plies, result.line);
+			// the proof of the first move was overwritten in the table, a mate without its move is no use to anyone
+			if (result.line.empty()) {
+				result.complete = false;
+				break;
+			}
+			result.mateIn = moves;
+			result.proofSize = GetProofSize(board, true, plies);
+			break;
+		}
+		// neither proven nor disproven, it was stopped
+		if (numbers.delta != 0) {
+			result.complete = false;
+			break;
+		}
+	}
+
+	result.nodes = m_Nodes;
+	result.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+// the node is won by the side to move as soon as one child is lost for the other side,
+// and lost once every child is won by the other side, so phi is the smallest delta of the children
+// and delta the sum of their phi
+template<BoardRepresentation B>
+void BasicMateSolver<B>::Expand(const B& board, bool attacker, int plies, uint32_t thresholdPhi, uint32_t thresholdDelta) {
+	m_Nodes++;
+	const std::vector<Move>& moves = board.GetLegalMoves();
+	std::vector<B> children;
+	children.reserve(moves.size());
+	for (const Move& move : moves) {
+		children.push_back(board);
+		children.back().ApplyMove(move);
+	}
+
+	while (true) {
+		uint32_t phi = INFINITE;
+		uint32_t delta = 0;
+		size_t best = 0;
+		uint32_t bestPhi = 0;
+		uint32_t secondDelta = INFINITE;
+		for (size_t i = 0; i < children.size(); i++) {
+			Numbers child = GetNumbers(children[i], not attacker, plies - 1);
+			if (child.delta < phi) {
+				secondDelta = phi;
+				phi = child.delta;
+				bestPhi = child.phi;
+				best = i;
+			}
+			else if (child.delta < secondDelta)
+				secondDelta = child.delta;
+			delta = std::min(INFINITE, delta + child.phi);
+		}
+
+		if (phi >= thresholdPhi or delta >= thresholdDelta or ShouldStop()) {
+			Store(board, plies, {phi, delta});
+			return;
+		}
+
+		// the most promising child is searched until it stops being the most promising one
+		// its budget is a quarter above the second best so that the search doesn't keep switching between the two
+		uint32_t childPhi = thresholdDelta - (delta - bestPhi);
+		uint32_t childDelta = std::min(thresholdPhi, std::min(INFINITE - 1, secondDelta + secondDelta / 4 + 1));
+		Expand(children[best], not attacker, plies - 1, childPhi, childDelta);
+	}
+}
+
+template<BoardRepresentation B>
+typename BasicMateSolver<B>::Numbers BasicMateSolver<B>::GetNumbers(const B& board, bool attacker, int plies) const {
+	// a draw or running out of plies is a win for the defender
+	const Numbers won = {0, INFINITE};
+	const Numbers lost = {INFINITE, 0};
+	if (board.GetLegalMoves().empty())
+		return board.IsCheck() or attacker ? lost : won;
+	if (board.IsDraw() or plies == 0)
+		return attacker ? lost : won;
+
+	uint64_t key = GetKey(board, plies);
+	const Entry& entry = m_Table[key & m_Mask];
+	if (entry.key == key)
+		return entry.numbers;
+	return {};
+}
+
+template<BoardRepresentation B>
+void BasicMateSolver<B>::Store(const B& board, int plies, Numbers numbers) {
+	uint64_t key = GetKey(board, plies);
+	m_Table[key & m_Mask] = {key, numbers};
+}
+
+// the same position is a different question with another number of plies left
+template<BoardRepresentation B>
+uint64_t BasicMateSolver<B>::GetKey(const B& board, int plies) const {
+	return board.GetHash() ^ (uint64_t)(plies + 1) * 0x9e3779b97f4a7c15ULL;
+}
+
+template<BoardRepresentation B>
+bool BasicMateSolver<B>::ShouldStop() {
+	if ((m_Nodes & 1023) == 0 and (m_StopToken.stop_requested() or m_Nodes >= m_MaxNodes))
+		m_Stopped = true;
+	return m_Stopped;
+}
+
+template<BoardRepresentation B>
+int BasicMateSolver<B>::GetProvenPlies(const B& board, bool attacker, int plies) const {
+	for (int left = plies % 2; left <= plies; left += 2) {
+		Numbers numbers = GetNumbers(board, attacker, left);
+		if (attacker ? numbers.phi == 0 : numbers.delta == 0)
+			return left;
+	}
+	return -1;
+}
+
+template<BoardRepresentation B>
+void BasicMateSolver<B>::FillLine(const B& board, bool attacker, int plies, std::vector<Move>& line) const {
+	const std::vector<Move>& moves = board.GetLegalMoves();
+	int bestPlies = -1;
+	size_t best = 0;
+	for (size_t i = 0; i < moves.size(); i++) {
+		B child = board;
+		child.ApplyMove(moves[i]);
+		int proven = GetProvenPlies(child, not attacker, plies - 1);
+		if (proven >= 0 and (bestPlies < 0 or (attacker ? proven < bestPlies : proven > bestPlies))) {
+			bestPlies = proven;
+			best = i;
+		}
+	}
+	if (bestPlies < 0)
+		return;
+
+	line.push_back(moves[best]);
+	B child = board;
+	child.ApplyMove(moves[best]);
+	FillLine(child, not attacker, bestPlies, line);
+}
+
+// one mating move at each of our turns, every move at each of theirs
+template<BoardRepresentation B>
+uint64_t BasicMateSolver<B>::GetProofSize(const B& board, bool attacker, int plies) const {
+	const std::vector<Move>& moves = board.GetLegalMoves();
+	uint64_t size = 1;
+	int bestPlies = -1;
+	std::optional<B> best;
+	for (const Move& move : moves) {
+		B child = board;
+		child.ApplyMove(move);
+		int proven = GetProvenPlies(child, not attacker, plies - 1);
+		if (proven < 0)
+			continue;
+		if (not attacker)
+			size += GetProofSize(child, true, proven);
+		else if (bestPlies < 0 or proven < bestPlies) {
+			bestPlies = proven;
+			best = child;
+		}
+	}
+	if (best)
+		size += GetProofSize(*best, false, bestPlies);
+	return size;
+}
+
+// the board representations the solver is built for
+template class BasicMateSolver<Board>;
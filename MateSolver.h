@@ -0,0 +1,71 @@
+#pragma once
+#include "Board.h"
+
+// what the mate solver found, for the side to move at the root
+struct MateResult {
+	// moves of the side to move until mate, nullopt if none was proven within the limit
+	std::optional<int> mateIn;
+	// never empty with a mate
+	std::vector<Move> line;
+	// nodes of the proof tree that are still in the table, how much had to be seen to be sure of the mate
+	uint64_t proofSize = 0;
+	uint64_t nodes = 0;
+	double timeMs = 0;
+	// false if the solver was stopped before it could say if there is a mate, or lost the line of the one it proved
+	bool complete = true;
+};
+
+// depth-first proof number search for a forced mate by the side to move
+// https://www.chessprogramming.org/DFPN
+// it always expands the position closest to deciding the question, which for forced lines is
+// far fewer nodes than a full width search: a mate is proven by one move at each of our turns
+// but every move at each of theirs, so it goes where the opponent has the fewest replies
+template<BoardRepresentation B>
+class BasicMateSolver {
+public:
+	explicit BasicMateSolver(size_t hashMegabytes = 16);
+
+	// the shortest mate in at most maxMoves moves, looked for one move deeper at a time
+	// gives up without a mate when the token asks it to or after maxNodes nodes
+	MateResult FindMate(const B& board, int maxMoves, std::stop_token stopToken = {},
+						uint64_t maxNodes = std::numeric_limits<uint64_t>::max());
+private:
+	// phi and delta are the proof and disproof numbers seen from the side to move:
+	// phi is how many positions still have to be solved for it to win, delta for it to lose
+	// "win" means mating for the attacker, and escaping the mate within the plies for the defender
+	struct Numbers {
+		uint32_t phi = 1;
+		uint32_t delta = 1;
+	};
+
+	struct Entry {
+		uint64_t key = 0;
+		Numbers numbers;
+	};
+
+	static constexpr uint32_t INFINITE = 1u << 30;
+
+	// searches the position until its numbers reach one of the thresholds
+	void Expand(const B& board, bool attacker, int plies, uint32_t thresholdPhi, uint32_t thresholdDelta);
+	// the numbers of a position, known if it is over, from the table or a first guess
+	[[nodiscard]] Numbers GetNumbers(const B& board, bool attacker, int plies) const;
+	void Store(const B& board, int plies, Numbers numbers);
+	[[nodiscard]] uint64_t GetKey(const B& board, int plies) const;
+	[[nodiscard]] bool ShouldStop();
+
+	// the fewest plies with the same parity as plies in which the table says the attacker mates, -1 if it doesn't know of any
+	[[nodiscard]] int GetProvenPlies(const B& board, bool attacker, int plies) const;
+	// follows the proof from the table, the defender resists as long as the table says it can
+	void FillLine(const B& board, bool attacker, int plies, std::vector<Move>& line) const;
+	[[nodiscard]] uint64_t GetProofSize(const B& board, bool attacker, int plies) const;
+
+	std::vector<Entry> m_Table;
+	uint64_t m_Mask;
+
+	std::stop_token m_StopToken;
+	uint64_t m_Nodes = 0;
+	uint64_t m_MaxNodes = 0;
+	bool m_Stopped = false;
+};
+
+typedef BasicMateSolver<Board> MateSolver;
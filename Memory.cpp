@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "Memory.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Memory {
+	static std::atomic_bool s_PinThreads = false;
+
+	const char* PagesName(Pages pages) {
+		switch (pages) {
+			case Pages::Huge: return "huge pages";
+			case Pages::TransparentHuge: return "transparent huge pages";
+			case Pages::Normal: return "normal pages";
+		}
+		return "";
+	}
+
+	LargeBuffer::LargeBuffer(size_t bytes) {
+		m_Size = bytes;
+		size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+		// explicit huge pages fail right away if there aren't enough reserved, which is the usual case
+		void* mapping = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (mapping != MAP_FAILED) {
+			m_Mapping = m_Data = mapping;
+			m_MappingSize = rounded;
+			m_Pages = Pages::Huge;
+			return;
+		}
+
+		// transparent huge pages only back whole aligned 2 MB ranges, so the mapping gets an extra one to align in
+		size_t padded = rounded + HUGE_PAGE_SIZE;
+		mapping = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED)
+			throw std::bad_alloc();
+		m_Mapping = mapping;
+		m_MappingSize = padded;
+		auto aligned = (reinterpret_cast<uintptr_t>(mapping) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+		m_Data = reinterpret_cast<void*>(aligned);
+		m_Pages = madvise(m_Data, rounded, MADV_HUGEPAGE) == 0 ? Pages::TransparentHuge : Pages::Normal;
+	}
+
+	LargeBuffer::LargeBuffer(LargeBuffer&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	LargeBuffer& LargeBuffer::operator=(LargeBuffer&& other) noexcept {
+		if (this != &other) {
+			Release();
+			m_Mapping = std::exchange(other.m_Mapping, nullptr);
+			m_MappingSize = std::exchange(other.m_MappingSize, 0);
+			m_Data = std::exchange(other.m_Data, nullptr);
+			m_Size = std::exchange(other.m_Size, 0);
+			m_Pages = other.m_Pages;
+		}
+		return *this;
+	}
+
+	LargeBuffer::~LargeBuffer() {
+		Release();
+	}
+
+	void LargeBuffer::Release() {
+		if (m_Mapping)
+			munmap(m_Mapping, m_MappingSize);
+		m_Mapping = m_Data = nullptr;
+		m_MappingSize = m_Size = 0;
+	}
+
+	MappedFile::MappedFile(const std::string& path, Access access, Sharing sharing) {
+		// a private mapping can be written without writing to the file
+		int fd = open(path.c_str(), (sharing == Sharing::Shared ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+		if (fd < 0)
+			throw std::runtime_error("could not open " + path);
+		struct stat status{};
+		if (fstat(fd, &status) < 0) {
+			close(fd);
+			throw std::runtime_error("could not stat " + path);
+		}
+
+		// an empty file has nothing to map, the mapping keeps the file alive once the descriptor is closed
+		m_Size = (size_t)status.st_size;
+		int protection = sharing == Sharing::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+		int flags = sharing == Sharing::Private ? MAP_PRIVATE : MAP_SHARED;
+		void* mapping = m_Size ? mmap(nullptr, m_Size, protection, flags, fd, 0) : nullptr;
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			m_Size = 0;
+			throw std::runtime_error("could not map " + path);
+		}
+		m_Data = mapping;
+		if (m_Data)
+			madvise(m_Data, m_Size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+		if (this != &other) {
+			Release();
+			m_Data = std::exchange(other.m_Data, nullptr);
+			m_Size = std::exchange(other.m_Size, 0);
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile() {
+		Release();
+	}
+
+	void MappedFile::Release() {
+		if (m_Data)
+			munmap(m_Data, m_Size);
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	void SetPinThreads(bool pin) {
+		s_PinThreads.store(pin, std::memory_order_relaxed);
+	}
+
+	bool IsPinningThreads() {
+		return s_PinThreads.load(std::memory_order_relaxed);
+	}
+
+	bool PinThread(int index) {
+		// the allowed set can be smaller than the machine (taskset, cgroups), only its cpus are used
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			return false;
+		int count = CPU_COUNT(&allowed);
+		if (count == 0)
+			return false;
+
+		int target = index % count;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (not CPU_ISSET(cpu, &allowed) or target-- > 0)
+				continue;
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			return sched_setaffinity(0, sizeof(set), &set) == 0;
+		}
+		return false;
+	}
+}
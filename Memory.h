@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// memory for the big tables of the engine and the files it reads, and where the threads using it run
+namespace Memory {
+	constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	enum class Pages : uint8_t {
+		// explicit 2 MB pages from the kernel's reserved pool (vm.nr_hugepages)
+		Huge,
+		// normal pages the kernel was asked to back with transparent huge pages
+		TransparentHuge,
+		Normal
+	};
+
+	[[nodiscard]] const char* PagesName(Pages pages);
+
+	// zeroed memory mapped straight from the kernel, on 2 MB pages when it can get them
+	// nothing is touched until it is used, so every page is placed on the numa node of the thread that first writes it
+	class LargeBuffer {
+	public:
+		LargeBuffer() = default;
+		explicit LargeBuffer(size_t bytes);
+		LargeBuffer(LargeBuffer&& other) noexcept;
+		LargeBuffer& operator=(LargeBuffer&& other) noexcept;
+		~LargeBuffer();
+
+		[[nodiscard]] void* Get() const { return m_Data; }
+		[[nodiscard]] size_t GetSize() const { return m_Size; }
+		[[nodiscard]] Pages GetPages() const { return m_Pages; }
+	private:
+		void Release();
+
+		// the mapping is bigger than the data when it had to be aligned to a huge page by hand
+		void* m_Mapping = nullptr;
+		size_t m_MappingSize = 0;
+		void* m_Data = nullptr;
+		size_t m_Size = 0;
+		Pages m_Pages = Pages::Normal;
+	};
+
+	// how a mapped file is going to be read, the kernel reads ahead for the sequential one only
+	enum class Access : uint8_t {
+		Sequential, Random
+	};
+
+	// what happens to the writes to a mapped file
+	enum class Sharing : uint8_t {
+		// it can't be written
+		ReadOnly,
+		// the written pages are copied and stay in the process, the file doesn't change
+		Private,
+		// the writes go to the file and every other process mapping it sees them
+		Shared
+	};
+
+	// a mapped file, nothing is read until it is touched and the pages are shared with every other reader
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		// throws std::runtime_error if the file can't be opened or mapped
+		explicit MappedFile(const std::string& path, Access access = Access::Sequential, Sharing sharing = Sharing::ReadOnly);
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		[[nodiscard]] const char* GetData() const { return static_cast<const char*>(m_Data); }
+		// only for a file that isn't mapped read only
+		[[nodiscard]] char* GetWritableData() const { return static_cast<char*>(m_Data); }
+		[[nodiscard]] size_t GetSize() const { return m_Size; }
+		[[nodiscard]] std::string_view GetView() const { return {GetData(), m_Size}; }
+	private:
+		void Release();
+
+		void* m_Data = nullptr;
+		size_t m_Size = 0;
+	};
+
+	// pinning is off by default, the scheduler usually knows better unless the machine is dedicated to the engine
+	void SetPinThreads(bool pin);
+	[[nodiscard]] bool IsPinningThreads();
+	// pins the calling thread to the index-th cpu it is allowed to run on, wrapping around
+	bool PinThread(int index);
+}
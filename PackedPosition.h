@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// a whole position in 32 bytes
+// the occupied squares are stored in a bitboard (bit i is RawBoard index i)
+// and the pieces on them as 4 bit codes, in the order of the set bits
+struct PackedPosition {
+	uint64_t occupancy = 0;
+	std::array<uint8_t, 16> pieces{};
+
+	// bit 0: black to move, bits 1-4: castling rights KQkq
+	uint8_t flags = 0;
+	// file of the en passant square + 1, 0 if there is none
+	uint8_t enPassant = 0;
+	uint8_t halfMoves = 0;
+	uint8_t reserved = 0;
+	uint16_t fullMoves = 1;
+	std::array<uint8_t, 2> padding{};
+
+	static constexpr uint8_t BLACK_TO_MOVE = 1 << 0;
+	static constexpr uint8_t WHITE_KING_SIDE = 1 << 1;
+	static constexpr uint8_t WHITE_QUEEN_SIDE = 1 << 2;
+	static constexpr uint8_t BLACK_KING_SIDE = 1 << 3;
+	static constexpr uint8_t BLACK_QUEEN_SIDE = 1 << 4;
+
+	[[nodiscard]] static constexpr uint8_t PieceToCode(char piece);
+	[[nodiscard]] static constexpr char CodeToPiece(uint8_t code);
+
+	// same placement, side to move, castling rights and en passant, the clocks are ignored
+	// this is what counts for the threefold repetition
+	[[nodiscard]] bool SamePosition(const PackedPosition& other) const {
+		return occupancy == other.occupancy and pieces == other.pieces and
+			   flags == other.flags and enPassant == other.enPassant;
+	}
+
+	bool operator==(const PackedPosition& other) const = default;
+};
+static_assert(sizeof(PackedPosition) == 32);
+
+namespace PieceCodes {
+	// code 0 is never used so that a zeroed nibble is not a piece
+	inline constexpr char PIECES[17] = " PNBRQKpnbrqk   ";
+
+	constexpr std::array<uint8_t, 128> Generate() {
+		std::array<uint8_t, 128> codes{};
+		for (uint8_t code = 1; code <= 12; code++)
+			codes[(unsigned char)PIECES[code]] = code;
+		return codes;
+	}
+	inline constexpr std::array<uint8_t, 128> CODES = Generate();
+}
+
+constexpr uint8_t PackedPosition::PieceToCode(char piece) {
+	return PieceCodes::CODES[(unsigned char)piece & 0x7f];
+}
+
+constexpr char PackedPosition::CodeToPiece(uint8_t code) {
+	return PieceCodes::PIECES[code & 0xf];
+}
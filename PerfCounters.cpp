@@ -0,0 +1,208 @@
+#include "pch.h"
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::atomic_bool PerfCounters::s_Enabled = false;
+std::mutex PerfCounters::s_RegistryMutex;
+std::vector<std::unique_ptr<PerfCounters::ThreadTotals>> PerfCounters::s_Threads;
+PerfCounters::Summary PerfCounters::s_RunSummary;
+
+// the file descriptors belong to the thread and are closed when it exits,
+// the totals are owned by the registry so they can be collected afterwards
+struct PerfCounters::ThreadCounters {
+	std::array<int, EVENT_COUNT> fds{};
+	Counts last{};
+	std::vector<SearchPhase> phases;
+	ThreadTotals* totals = nullptr;
+	bool anyOpen = false;
+
+	ThreadCounters() { fds.fill(-1); }
+	~ThreadCounters() {
+#ifdef __linux__
+		for (int fd : fds)
+			if (fd >= 0)
+				close(fd);
+#endif
+	}
+
+	[[nodiscard]] Counts Read() const {
+		Counts counts{};
+#ifdef __linux__
+		for (size_t event = 0; event < EVENT_COUNT; event++) {
+			if (fds[event] < 0)
+				continue;
+			// value, time enabled, time running
+			uint64_t data[3] = {0, 0, 0};
+			if (read(fds[event], data, sizeof(data)) != sizeof(data) or not data[2])
+				continue;
+			// scale the value up if the kernel had to multiplex the counter
+			counts[event] = data[1] == data[2] ? data[0] :
+					(uint64_t)((double)data[0] * (double)data[1] / (double)data[2]);
+		}
+#endif
+		return counts;
+	}
+};
+
+#ifdef __linux__
+static int OpenEvent(uint32_t type, uint64_t config) {
+	perf_event_attr attr{};
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	// measure the calling thread on whatever cpu it runs
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t CacheConfig(uint64_t cache) {
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+PerfCounters::ThreadCounters& PerfCounters::GetThreadCounters() {
+	thread_local ThreadCounters t_Counters;
+	if (t_Counters.totals)
+		return t_Counters;
+
+#ifdef __linux__
+	t_Counters.fds[Cycles] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	t_Counters.fds[Instructions] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	t_Counters.fds[BranchMisses] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	t_Counters.fds[L1DMisses] = OpenEvent(PERF_TYPE_HW_CACHE, CacheConfig(PERF_COUNT_HW_CACHE_L1D));
+	t_Counters.fds[LLCMisses] = OpenEvent(PERF_TYPE_HW_CACHE, CacheConfig(PERF_COUNT_HW_CACHE_LL));
+	t_Counters.fds[DTLBMisses] = OpenEvent(PERF_TYPE_HW_CACHE, CacheConfig(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+	t_Counters.anyOpen = std::ranges::any_of(t_Counters.fds, [](int fd) { return fd >= 0; });
+	t_Counters.last = t_Counters.Read();
+	t_Counters.phases.push_back(SearchPhase::Search);
+
+	std::lock_guard lock(s_RegistryMutex);
+	s_Threads.push_back(std::make_unique<ThreadTotals>());
+	t_Counters.totals = s_Threads.back().get();
+	for (size_t event = 0; event < EVENT_COUNT; event++)
+		t_Counters.totals->summary.available[event] = t_Counters.fds[event] >= 0;
+	return t_Counters;
+}
+
+// everything counted since the last reading goes to the phase on top of the stack
+void PerfCounters::ChargeCurrentPhase(ThreadCounters& counters) {
+	Counts now = counters.Read();
+	size_t phase = static_cast<size_t>(counters.phases.back());
+
+	std::lock_guard lock(counters.totals->mutex);
+	for (size_t event = 0; event < EVENT_COUNT; event++)
+		counters.totals->summary.phases[phase][event] += now[event] - counters.last[event];
+	counters.last = now;
+}
+
+PerfCounters::Phase::Phase(SearchPhase phase) : m_Active(IsEnabled()) {
+	if (not m_Active)
+		return;
+	ThreadCounters& counters = GetThreadCounters();
+	if (not counters.anyOpen) {
+		m_Active = false;
+		return;
+	}
+	ChargeCurrentPhase(counters);
+	counters.phases.push_back(phase);
+}
+
+PerfCounters::Phase::~Phase() {
+	if (not m_Active)
+		return;
+	ThreadCounters& counters = GetThreadCounters();
+	ChargeCurrentPhase(counters);
+	counters.phases.pop_back();
+}
+
+bool PerfCounters::OpenForThread() {
+	return GetThreadCounters().anyOpen;
+}
+
+PerfCounters::Summary& PerfCounters::Summary::operator+=(const Summary& other) {
+	for (size_t phase = 0; phase < PHASE_COUNT; phase++)
+		for (size_t event = 0; event < EVENT_COUNT; event++)
+			phases[phase][event] += other.phases[phase][event];
+	for (size_t event = 0; event < EVENT_COUNT; event++)
+		available[event] = available[event] or other.available[event];
+	return *this;
+}
+
+PerfCounters::Summary PerfCounters::CollectMove() {
+	// flush what the calling thread counted since its last phase change
+	if (IsEnabled() and GetThreadCounters().anyOpen)
+		ChargeCurrentPhase(GetThreadCounters());
+
+	Summary move;
+	std::lock_guard lock(s_RegistryMutex);
+	for (const auto& totals : s_Threads) {
+		std::lock_guard threadLock(totals->mutex);
+		move += totals->summary;
+		totals->summary.phases = {};
+	}
+	s_RunSummary += move;
+	return move;
+}
+
+void PerfCounters::ResetRun() {
+	std::lock_guard lock(s_RegistryMutex);
+	s_RunSummary = {};
+}
+
+std::ostream& operator<<(std::ostream& ostream, SearchPhase phase) {
+	switch (phase) {
+		case SearchPhase::Search: ostream << "search"; break;
+		case SearchPhase::MoveGeneration: ostream << "movegen"; break;
+		case SearchPhase::Evaluation: ostream << "eval"; break;
+		case SearchPhase::TTProbe: ostream << "tt probe"; break;
+		case SearchPhase::Quiescence: ostream << "quiescence"; break;
+		default: ostream << "?"; break;
+	}
+	return ostream;
+}
+
+void PerfCounters::PrintSummary(std::ostream& ostream, const Summary& summary) {
+	if (std::ranges::none_of(summary.available, [](bool available) { return available; })) {
+		ostream << "perf counters unavailable (check /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+		return;
+	}
+
+	static const char* headers[EVENT_COUNT] = {"cycles", "instr", "br-miss", "L1D-miss", "LLC-miss", "dTLB-miss"};
+	ostream << std::left << std::setw(12) << "phase";
+	for (const char* header : headers)
+		ostream << std::right << std::setw(14) << header;
+	ostream << std::setw(8) << "IPC" << std::endl;
+
+	auto printRow = [&](const std::string& name, const Counts& counts) {
+		ostream << std::left << std::setw(12) << name << std::right;
+		for (size_t event = 0; event < EVENT_COUNT; event++) {
+			if (summary.available[event])
+				ostream << std::setw(14) << counts[event];
+			else
+				ostream << std::setw(14) << "n/a";
+		}
+		if (counts[Cycles])
+			ostream << std::setw(8) << std::fixed << std::setprecision(2) <<
+			static_cast<double>(counts[Instructions]) / static_cast<double>(counts[Cycles]);
+		ostream << std::endl;
+	};
+
+	Counts total{};
+	for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+		std::stringstream name;
+		name << static_cast<SearchPhase>(phase);
+		printRow(name.str(), summary.phases[phase]);
+		for (size_t event = 0; event < EVENT_COUNT; event++)
+			total[event] += summary.phases[phase][event];
+	}
+	printRow("total", total);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <mutex>
+
+// parts of the search the hardware counters are attributed to
+enum class SearchPhase : uint8_t {
+	Search, MoveGeneration, Evaluation, TTProbe, Quiescence, Count
+};
+
+// hardware performance counters opened through perf_event_open for the search threads
+// counts are attributed to the innermost phase that is active on the thread,
+// so nested phases (move generation inside the evaluation) are not counted twice
+class PerfCounters {
+public:
+	enum Event {
+		Cycles, Instructions, BranchMisses, L1DMisses, LLCMisses, DTLBMisses, EVENT_COUNT
+	};
+	static constexpr size_t PHASE_COUNT = static_cast<size_t>(SearchPhase::Count);
+
+	typedef std::array<uint64_t, EVENT_COUNT> Counts;
+
+	struct Summary {
+		std::array<Counts, PHASE_COUNT> phases{};
+		// which events could be opened, the others are reported as n/a
+		std::array<bool, EVENT_COUNT> available{};
+
+		Summary& operator+=(const Summary& other);
+	};
+
+	// RAII marker for a phase of the search
+	class Phase {
+	public:
+		explicit Phase(SearchPhase phase);
+		~Phase();
+	private:
+		bool m_Active;
+	};
+
+	// counters are only read when enabled, a phase marker costs a relaxed load otherwise
+	static void SetEnabled(bool enabled) { s_Enabled.store(enabled, std::memory_order_relaxed); }
+	[[nodiscard]] static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+	// open the counters for the calling thread, returns false if the kernel refused all of them
+	static bool OpenForThread();
+
+	// merge and reset the counts of all the threads, the result is also added to the run summary
+	[[nodiscard]] static Summary CollectMove();
+	[[nodiscard]] static const Summary& GetRunSummary() { return s_RunSummary; }
+	static void ResetRun();
+
+	static void PrintSummary(std::ostream& ostream, const Summary& summary);
+private:
+	struct ThreadCounters;
+	struct ThreadTotals {
+		std::mutex mutex;
+		Summary summary;
+	};
+
+	static ThreadCounters& GetThreadCounters();
+	static void ChargeCurrentPhase(ThreadCounters& counters);
+
+	static std::atomic_bool s_Enabled;
+	static std::mutex s_RegistryMutex;
+	static std::vector<std::unique_ptr<ThreadTotals>> s_Threads;
+	static Summary s_RunSummary;
+};
+
+std::ostream& operator<<(std::ostream& ostream, SearchPhase phase);
+
+# if PERF_COUNTERS == 1
+	#define PERF_PHASE(phase) PerfCounters::Phase PROFILE_CONCAT(perfPhase, __LINE__)(phase)
+#else
+	#define PERF_PHASE(phase)
+#endif
@@ -0,0 +1,419 @@
+#include "pch.h"
+#include "Pgn.h"
+#include "Memory.h"
+#include "ThreadPool.h"
+
+namespace Pgn {
+	namespace {
+		constexpr std::array<std::string_view, 7> SEVEN_TAG_ROSTER = {"Event", "Site", "Date", "Round", "White", "Black", "Result"};
+		constexpr size_t LINE_LENGTH = 80;
+
+		bool IsResult(std::string_view token) {
+			return token == "1-0" or token == "0-1" or token == "1/2-1/2" or token == "*";
+		}
+
+		// games start with their tags after a blank line, so a chunk boundary is the first such tag line after the position
+		size_t NextGameStart(std::string_view text, size_t position) {
+			while (true) {
+				position = text.find("\n[", position);
+				if (position == std::string_view::npos)
+					return text.size();
+				size_t lineStart = text.rfind('\n', position - 1);
+				lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+				if (std::ranges::all_of(text.substr(lineStart, position - lineStart), [](char c) { return std::isspace((unsigned char)c); }))
+					return position + 1;
+				position++;
+			}
+		}
+
+		// the tokens of the movetext, with everything that isn't a move or a result skipped
+		class Tokenizer {
+		public:
+			explicit Tokenizer(std::string_view text) : m_Text(text) {}
+
+			// the next tag line or token, empty at the end of the text
+			std::string_view Next() {
+				while (m_Position < m_Text.size()) {
+					char c = m_Text[m_Position];
+					if (std::isspace((unsigned char)c))
+						m_Position++;
+					else if (c == '{')
+						SkipPast('}');
+					else if (c == ';' or (c == '%' and (m_Position == 0 or m_Text[m_Position - 1] == '\n')))
+						SkipPast('\n');
+					else if (c == '(')
+						SkipVariation();
+					else if (c == '$') {
+						m_Position++;
+						while (m_Position < m_Text.size() and std::isdigit((unsigned char)m_Text[m_Position]))
+							m_Position++;
+					}
+					else if (c == '[') {
+						size_t end = m_Text.find(']', m_Position);
+						end = end == std::string_view::npos ? m_Text.size() : end + 1;
+						return Take(end);
+					}
+					else {
+						size_t end = m_Position;
+						while (end < m_Text.size() and not std::isspace((unsigned char)m_Text[end]) and
+							   std::string_view("{}();[$").find(m_Text[end]) == std::string_view::npos)
+							end++;
+						return Take(end);
+					}
+				}
+				return {};
+			}
+		private:
+			std::string_view Take(size_t end) {
+				std::string_view token = m_Text.substr(m_Position, end - m_Position);
+				m_Position = end;
+				return token;
+			}
+
+			void SkipPast(char c) {
+				size_t end = m_Text.find(c, m_Position);
+				m_Position = end == std::string_view::npos ? m_Text.size() : end + 1;
+			}
+
+			// variations can be nested and hold comments with parentheses in them
+			void SkipVariation() {
+				int depth = 0;
+				while (m_Position < m_Text.size()) {
+					char c = m_Text[m_Position];
+					if (c == '{') {
+						SkipPast('}');
+						continue;
+					}
+					m_Position++;
+					if (c == '(')
+						depth++;
+					else if (c == ')' and --depth == 0)
+						return;
+				}
+			}
+
+			std::string_view m_Text;
+			size_t m_Position = 0;
+		};
+
+		// [Name "Value"], the value can hold escaped quotes and backslashes
+		bool ParseTag(std::string_view line, std::string& name, std::string& value) {
+			size_t nameEnd = line.find_first_of(" \t", 1);
+			size_t open = line.find('"');
+			if (nameEnd == std::string_view::npos or open == std::string_view::npos)
+				return false;
+			name.assign(line.substr(1, nameEnd - 1));
+			value.clear();
+			for (size_t i = open + 1; i < line.size() and line[i] != '"'; i++) {
+				if (line[i] == '\\' and i + 1 < line.size())
+					i++;
+				value += line[i];
+			}
+			return true;
+		}
+
+		void ReadChunk(std::string_view text, size_t chunk, const GameCallback& onGame, size_t maxPlies, ReadStats& stats) {
+			Tokenizer tokenizer(text);
+			Game game;
+			std::optional<Board> board;
+			bool inMovetext = false;
+			bool failed = false;
+
+			auto finish = [&] {
+				if (failed)
+					stats.errors++;
+				else if (inMovetext or not game.tags.empty()) {
+					stats.games++;
+					stats.plies += game.moves.size();
+					onGame(game, chunk);
+				}
+				game.Clear();
+				board.reset();
+				inMovetext = failed = false;
+			};
+
+			std::string name, value;
+			for (std::string_view token = tokenizer.Next(); not token.empty(); token = tokenizer.Next()) {
+				if (token.front() == '[') {
+					// the tags of the next game, the last one had no result
+					if (inMovetext)
+						finish();
+					if (ParseTag(token, name, value)) {
+						if (name == "FEN") {
+							game.startFen = value;
+							// a game from a position that can't be read is skipped like one with a move that can't
+							try {
+								board.emplace(game.startFen);
+							}
+							catch (const std::runtime_error&) {
+								failed = true;
+							}
+						}
+						game.tags.emplace_back(std::move(name), std::move(value));
+					}
+					continue;
+				}
+
+				inMovetext = true;
+				if (IsResult(token)) {
+					game.result = token;
+					finish();
+					continue;
+				}
+
+				// move numbers, "12." and "12...", can be glued to the move
+				size_t numberEnd = token.find_first_not_of("0123456789.");
+				if (numberEnd != 0 and token.substr(0, numberEnd).find('.') != std::string_view::npos)
+					token.remove_prefix(numberEnd == std::string_view::npos ? token.size() : numberEnd);
+				if (token.empty() or failed or game.moves.size() >= maxPlies)
+					continue;
+
+				if (not board)
+					board.emplace(game.startFen);
+				std::optional<Move> move = SanToMove(*board, token);
+				if (not move) {
+					failed = true;
+					continue;
+				}
+				game.moves.push_back(*move);
+				board->ApplyMove(*move);
+			}
+			if (inMovetext or failed)
+				finish();
+		}
+	}
+
+	const std::string* Game::GetTag(std::string_view name) const {
+		for (const auto& [tagName, value] : tags)
+			if (tagName == name)
+				return &value;
+		return nullptr;
+	}
+
+	void Game::SetTag(std::string_view name, std::string value) {
+		for (auto& [tagName, tagValue] : tags)
+			if (tagName == name) {
+				tagValue = std::move(value);
+				return;
+			}
+		tags.emplace_back(std::string(name), std::move(value));
+	}
+
+	void Game::Clear() {
+		tags.clear();
+		startFen = START_FEN;
+		moves.clear();
+		result = "*";
+	}
+
+	template<BoardRepresentation B>
+	std::string MoveToSan(const B& board, const Move& move) {
+		const char piece = board.GetPiece(move.from);
+		const char type = (char)(piece | 0x20);
+		std::string san;
+
+		if (type == 'k' and std::abs(move.to.first - move.from.first) == 2)
+			san = move.to.first > move.from.first ? "O-O" : "O-O-O";
+		else {
+			const bool capture = board.IsCapture(move);
+			if (type == 'p') {
+				if (capture)
+					san += (char)('a' + move.from.first);
+			}
+			else {
+				san += (char)(type - 'a' + 'A');
+				// the file tells apart the pieces of the same kind that can go there, else the rank, else both
+				bool ambiguous = false, sameFile = false, sameRank = false;
+				for (const Move& other : board.GetLegalMoves()) {
+					if (other.to != move.to or other.from == move.from or board.GetPiece(other.from) != piece)
+						continue;
+					ambiguous = true;
+					sameFile |= other.from.first == move.from.first;
+					sameRank |= other.from.second == move.from.second;
+				}
+				if (ambiguous and (not sameFile or sameRank))
+					san += (char)('a' + move.from.first);
+				if (ambiguous and sameFile)
+					san += (char)('1' + move.from.second);
+			}
+			if (capture)
+				san += 'x';
+			san += Coord2Chess(move.to);
+			if (move.promote) {
+				san += '=';
+				san += (char)(move.promote.value() & ~0x20);
+			}
+		}
+
+		B child = board;
+		child.ApplyMove(move);
+		if (child.IsCheck())
+			san += child.GetLegalMoves().empty() ? '#' : '+';
+		return san;
+	}
+
+	template<BoardRepresentation B>
+	std::optional<Move> SanToMove(const B& board, std::string_view san) {
+		while (not san.empty() and std::string_view("+#!?").find(san.back()) != std::string_view::npos)
+			san.remove_suffix(1);
+		if (san.empty())
+			return std::nullopt;
+
+		std::optional<Move> found;
+		auto match = [&](auto&& predicate) -> std::optional<Move> {
+			for (const Move& move : board.GetLegalMoves()) {
+				if (not predicate(move))
+					continue;
+				if (found)
+					return std::nullopt;
+				found = move;
+			}
+			return found;
+		};
+
+		if (san == "O-O" or san == "0-0" or san == "O-O-O" or san == "0-0-0") {
+			int direction = san.size() == 3 ? 2 : -2;
+			return match([&](const Move& move) {
+				return (board.GetPiece(move.from) | 0x20) == 'k' and move.to.first - move.from.first == direction;
+			});
+		}
+
+		char type = 'p';
+		if (std::string_view("NBRQK").find(san.front()) != std::string_view::npos) {
+			type = (char)(san.front() | 0x20);
+			san.remove_prefix(1);
+		}
+
+		// "e8=Q" and "e8Q"
+		std::optional<char> promote;
+		if (san.size() > 2 and std::string_view("NBRQnbrq").find(san.back()) != std::string_view::npos) {
+			promote = (char)(san.back() | 0x20);
+			san.remove_suffix(1);
+			if (san.back() == '=')
+				san.remove_suffix(1);
+		}
+
+		if (san.size() < 2)
+			return std::nullopt;
+		char toFile = san[san.size() - 2];
+		char toRank = san[san.size() - 1];
+		if (toFile < 'a' or toFile > 'h' or toRank < '1' or toRank > '8')
+			return std::nullopt;
+		Coord to = Chess2Coord(san.data() + san.size() - 2);
+
+		// what is left is the disambiguation and the capture
+		std::optional<int> fromFile, fromRank;
+		for (char c : san.substr(0, san.size() - 2)) {
+			if ('a' <= c and c <= 'h')
+				fromFile = c - 'a';
+			else if ('1' <= c and c <= '8')
+				fromRank = c - '1';
+			else if (c != 'x' and c != ':' and c != '-')
+				return std::nullopt;
+		}
+
+		return match([&](const Move& move) {
+			return move.to == to and (board.GetPiece(move.from) | 0x20) == type and
+				   (not fromFile or move.from.first == *fromFile) and (not fromRank or move.from.second == *fromRank) and
+				   (move.promote ? promote and (move.promote.value() | 0x20) == *promote : not promote);
+		});
+	}
+
+	void Write(std::ostream& ostream, const Game& game) {
+		auto writeTag = [&ostream](std::string_view name, std::string_view value) {
+			ostream << '[' << name << " \"";
+			for (char c : value) {
+				if (c == '"' or c == '\\')
+					ostream << '\\';
+				ostream << c;
+			}
+			ostream << "\"]\n";
+		};
+
+		for (std::string_view name : SEVEN_TAG_ROSTER) {
+			const std::string* value = game.GetTag(name);
+			if (name == "Result")
+				writeTag(name, game.result);
+			else
+				writeTag(name, value ? std::string_view(*value) : name == "Date" ? "????.??.??" : "?");
+		}
+		for (const auto& [name, value] : game.tags)
+			if (std::ranges::find(SEVEN_TAG_ROSTER, name) == SEVEN_TAG_ROSTER.end() and name != "FEN" and name != "SetUp")
+				writeTag(name, value);
+		if (game.startFen != START_FEN) {
+			writeTag("SetUp", "1");
+			writeTag("FEN", game.startFen);
+		}
+		ostream << '\n';
+
+		std::string line;
+		auto append = [&](std::string_view token) {
+			if (not line.empty() and line.size() + 1 + token.size() > LINE_LENGTH) {
+				ostream << line << '\n';
+				line.clear();
+			}
+			if (not line.empty())
+				line += ' ';
+			line += token;
+		};
+
+		Board board(game.startFen);
+		for (size_t i = 0; i < game.moves.size(); i++) {
+			if (board.IsWhiteTurn())
+				append(std::to_string(board.GetFullMoves()) + ".");
+			else if (i == 0)
+				append(std::to_string(board.GetFullMoves()) + "...");
+			append(MoveToSan(board, game.moves[i]));
+			board.ApplyMove(game.moves[i]);
+		}
+		append(game.result);
+		ostream << line << "\n\n";
+	}
+
+	ReadStats Read(std::string_view text, size_t chunks, const GameCallback& onGame, ThreadPool* pool, size_t maxPlies) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<size_t> bounds = {0};
+		for (size_t i = 1; i < std::max<size_t>(chunks, 1); i++) {
+			size_t bound = NextGameStart(text, std::max(bounds.back(), text.size() * i / chunks));
+			if (bound >= text.size())
+				break;
+			bounds.push_back(bound);
+		}
+		bounds.push_back(text.size());
+
+		std::vector<ReadStats> chunkStats(bounds.size() - 1);
+		std::optional<ThreadPool::Batch> batch;
+		if (pool)
+			batch.emplace(*pool);
+		for (size_t chunk = 0; chunk + 1 < bounds.size(); chunk++) {
+			auto read = [&, chunk] {
+				ReadChunk(text.substr(bounds[chunk], bounds[chunk + 1] - bounds[chunk]), chunk, onGame, maxPlies, chunkStats[chunk]);
+			};
+			if (batch)
+				batch->Submit(read);
+			else
+				read();
+		}
+		if (batch)
+			batch->Wait();
+
+		ReadStats stats;
+		for (const ReadStats& chunk : chunkStats) {
+			stats.games += chunk.games;
+			stats.plies += chunk.plies;
+			stats.errors += chunk.errors;
+		}
+		stats.bytes = text.size();
+		stats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+
+	ReadStats ReadFile(const std::string& path, size_t chunks, const GameCallback& onGame, ThreadPool* pool, size_t maxPlies) {
+		Memory::MappedFile file(path);
+		return Read(file.GetView(), chunks, onGame, pool, maxPlies);
+	}
+
+	// the board representations san is built for
+	template std::string MoveToSan(const Board& board, const Move& move);
+	template std::optional<Move> SanToMove(const Board& board, std::string_view san);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Board.h"
+
+class ThreadPool;
+
+// standard algebraic notation and pgn files
+// https://www.saremba.de/chessgml/standards/pgn/pgn-complete.htm
+namespace Pgn {
+	constexpr std::string_view START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+	struct Game {
+		// in the order of the file, the seven tag roster first when written
+		std::vector<std::pair<std::string, std::string>> tags;
+		// the FEN tag if there is one
+		std::string startFen = std::string(START_FEN);
+		std::vector<Move> moves;
+		// "1-0", "0-1", "1/2-1/2" or "*"
+		std::string result = "*";
+
+		[[nodiscard]] const std::string* GetTag(std::string_view name) const;
+		void SetTag(std::string_view name, std::string value);
+		void Clear();
+	};
+
+	// the move in san, with the check or mate suffix, it has to be legal on the board
+	template<BoardRepresentation B>
+	[[nodiscard]] std::string MoveToSan(const B& board, const Move& move);
+	// the legal move the san stands for, nullopt if there is none or more than one
+	// annotations like "!?" and the check suffixes are ignored
+	template<BoardRepresentation B>
+	[[nodiscard]] std::optional<Move> SanToMove(const B& board, std::string_view san);
+
+	// the tags, then the moves in san wrapped at 80 columns and the result
+	void Write(std::ostream& ostream, const Game& game);
+
+	struct ReadStats {
+		uint64_t games = 0;
+		uint64_t plies = 0;
+		// games with a fen tag or a move that isn't legal or can't be read, they are skipped
+		uint64_t errors = 0;
+		uint64_t bytes = 0;
+		double timeMs = 0;
+	};
+
+	// called once per game, the game is only valid during the call
+	typedef std::function<void(const Game& game, size_t chunk)> GameCallback;
+
+	// the text is cut into chunks at game boundaries and each chunk is read in order by one task of the pool
+	// so the callback can keep its results per chunk without a lock, chunks is how many to cut at most
+	// comments, variations and numeric annotations are skipped, and so are the moves after maxPlies without being decoded
+	ReadStats Read(std::string_view text, size_t chunks, const GameCallback& onGame, ThreadPool* pool = nullptr,
+				   size_t maxPlies = SIZE_MAX);
+	// the file is mapped rather than read, so a database bigger than the memory works too
+	ReadStats ReadFile(const std::string& path, size_t chunks, const GameCallback& onGame, ThreadPool* pool = nullptr,
+					   size_t maxPlies = SIZE_MAX);
+}
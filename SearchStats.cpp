@@ -0,0 +1,205 @@
+#include "pch.h"
+#include "SearchStats.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void SearchStats::Accumulate(const std::vector<ThreadSearchCounters>& counters, double ticksPerMs) {
+	uint64_t cutoffs = 0;
+	uint64_t firstMoveCutoffs = 0;
+	uint64_t moveGenTicks = 0;
+	uint64_t evalTicks = 0;
+
+	for (const ThreadSearchCounters& thread : counters) {
+		nodesPerThread.push_back(thread.nodes);
+		nodes += thread.nodes;
+		qNodes += thread.qNodes;
+		cutoffs += thread.cutoffs;
+		firstMoveCutoffs += thread.firstMoveCutoffs;
+		ttProbes += thread.ttProbes;
+		ttHits += thread.ttHits;
+		moveGenTicks += thread.moveGenTicks;
+		evalTicks += thread.evalTicks;
+		nullMoveTries += thread.nullMoveTries;
+		nullMoveCutoffs += thread.nullMoveCutoffs;
+		lateMoveReductions += thread.lateMoveReductions;
+		lateMoveResearches += thread.lateMoveResearches;
+		reverseFutilityPrunes += thread.reverseFutilityPrunes;
+		futilityPrunes += thread.futilityPrunes;
+		razorPrunes += thread.razorPrunes;
+		seePrunes += thread.seePrunes;
+		nullWindowSearches += thread.nullWindowSearches;
+		pvsResearches += thread.pvsResearches;
+		aspirationResearches += thread.aspirationResearches;
+		selDepth = std::max(selDepth, thread.selDepth);
+	}
+
+	nps = timeMs > 0 ? static_cast<double>(nodes) * 1000.0 / timeMs : 0;
+	effectiveBranchingFactor = depth > 0 ? std::pow(static_cast<double>(nodes), 1.0 / depth) : 0;
+	firstMoveCutoffRate = cutoffs ? static_cast<double>(firstMoveCutoffs) / static_cast<double>(cutoffs) : 0;
+	ttHitRate = ttProbes ? static_cast<double>(ttHits) / static_cast<double>(ttProbes) : 0;
+	pvsResearchRate = nullWindowSearches ? static_cast<double>(pvsResearches) / static_cast<double>(nullWindowSearches) : 0;
+	quiescenceShare = nodes ? static_cast<double>(qNodes) / static_cast<double>(nodes) : 0;
+
+	moveGenMs = static_cast<double>(moveGenTicks) / ticksPerMs;
+	evalMs = static_cast<double>(evalTicks) / ticksPerMs;
+	searchMs = std::max(0.0, timeMs - moveGenMs - evalMs);
+}
+
+std::string SearchStats::ToJson() const {
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << "{\"fen\":\"" << fen << "\"";
+	ss << ",\"best_move\":\"" << Move2Chess(bestMove) << "\"";
+	ss << ",\"score\":" << score;
+	ss << ",\"depth\":" << depth;
+	ss << ",\"stopped\":" << (stopped ? "true" : "false");
+	ss << ",\"seldepth\":" << selDepth;
+	ss << ",\"nodes\":" << nodes;
+	ss << ",\"nodes_per_thread\":[";
+	for (size_t i = 0; i < nodesPerThread.size(); i++)
+		ss << (i ? "," : "") << nodesPerThread[i];
+	ss << "]";
+	ss << ",\"time_ms\":" << timeMs;
+	ss << ",\"nps\":" << nps;
+	ss << ",\"ebf\":" << effectiveBranchingFactor;
+	ss << ",\"first_move_cutoff_rate\":" << firstMoveCutoffRate;
+	ss << ",\"tt_probes\":" << ttProbes;
+	ss << ",\"tt_hits\":" << ttHits;
+	ss << ",\"tt_hit_rate\":" << ttHitRate;
+	ss << ",\"qnodes\":" << qNodes;
+	ss << ",\"quiescence_share\":" << quiescenceShare;
+	ss << ",\"pruning\":{\"null_move_tries\":" << nullMoveTries << ",\"null_move_cutoffs\":" << nullMoveCutoffs <<
+	",\"lmr\":" << lateMoveReductions << ",\"lmr_researches\":" << lateMoveResearches <<
+	",\"reverse_futility\":" << reverseFutilityPrunes << ",\"futility\":" << futilityPrunes <<
+	",\"razoring\":" << razorPrunes << ",\"see\":" << seePrunes << "}";
+	ss << ",\"pvs\":{\"null_window_searches\":" << nullWindowSearches << ",\"researches\":" << pvsResearches <<
+	",\"research_rate\":" << pvsResearchRate << ",\"aspiration_researches\":" << aspirationResearches << "}";
+	ss << ",\"time_split_ms\":{\"movegen\":" << moveGenMs << ",\"eval\":" << evalMs << ",\"search\":" << searchMs << "}";
+	ss << "}";
+	return ss.str();
+}
+
+std::ostream& operator<<(std::ostream& ostream, const SearchStats& stats) {
+	ostream << std::fixed << std::setprecision(2);
+	ostream << "depth " << stats.depth << "/" << stats.selDepth << (stats.stopped ? " (stopped)" : "") <<
+	" | " << stats.nodes / 1000 << " k nodes in " << stats.timeMs << "[ms] (" << stats.nps / 1000 << " k nps)" <<
+	" | ebf " << stats.effectiveBranchingFactor <<
+	" | first move cutoffs " << stats.firstMoveCutoffRate * 100 << "%" <<
+	" | tt hits " << stats.ttHitRate * 100 << "%" <<
+	" | quiescence " << stats.quiescenceShare * 100 << "%" << std::endl;
+
+	ostream << "time split: movegen " << stats.moveGenMs << "[ms] eval " << stats.evalMs <<
+	"[ms] search " << stats.searchMs << "[ms] | nodes per thread:";
+	for (uint64_t nodes : stats.nodesPerThread)
+		ostream << " " << nodes;
+
+	ostream << std::endl << "pruning: null move " << stats.nullMoveCutoffs << "/" << stats.nullMoveTries <<
+	" | lmr " << stats.lateMoveReductions << " (" << stats.lateMoveResearches << " re-searched)" <<
+	" | reverse futility " << stats.reverseFutilityPrunes << " | futility " << stats.futilityPrunes <<
+	" | razoring " << stats.razorPrunes << " | see " << stats.seePrunes;
+
+	ostream << std::endl << "pvs re-searches " << stats.pvsResearches << "/" << stats.nullWindowSearches <<
+	" (" << stats.pvsResearchRate * 100 << "%) | aspiration re-searches " << stats.aspirationResearches;
+	return ostream;
+}
+
+StatsWriter::~StatsWriter() {
+	Close();
+}
+
+bool StatsWriter::Open(const std::string& target) {
+	std::lock_guard lock(m_Mutex);
+	if (m_Fd >= 0)
+		close(m_Fd);
+	m_Fd = -1;
+	m_IsSocket = false;
+
+	if (target.starts_with("unix:")) {
+		std::string path = target.substr(5);
+		sockaddr_un address{};
+		if (path.size() >= sizeof(address.sun_path))
+			return false;
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			return false;
+		if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+			close(fd);
+			return false;
+		}
+		m_Fd = fd;
+		m_IsSocket = true;
+		return true;
+	}
+
+	if (target.starts_with("tcp:")) {
+		std::string hostPort = target.substr(4);
+		size_t colon = hostPort.find_last_of(':');
+		if (colon == std::string::npos)
+			return false;
+		std::string host = hostPort.substr(0, colon);
+		std::string port = hostPort.substr(colon + 1);
+
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* result = nullptr;
+		if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+			return false;
+
+		for (addrinfo* info = result; info; info = info->ai_next) {
+			int fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+			if (fd < 0)
+				continue;
+			if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+				m_Fd = fd;
+				m_IsSocket = true;
+				break;
+			}
+			close(fd);
+		}
+		freeaddrinfo(result);
+		return m_Fd >= 0;
+	}
+
+	// anything else is a file, lines are appended to it
+	m_Fd = open(target.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	return m_Fd >= 0;
+}
+
+void StatsWriter::Close() {
+	std::lock_guard lock(m_Mutex);
+	if (m_Fd >= 0)
+		close(m_Fd);
+	m_Fd = -1;
+}
+
+void StatsWriter::Write(const SearchStats& stats) {
+	std::string line = stats.ToJson() + '\n';
+
+	std::lock_guard lock(m_Mutex);
+	if (m_Fd < 0)
+		return;
+
+	size_t written = 0;
+	while (written < line.size()) {
+		// don't let a closed dashboard connection kill the engine with a SIGPIPE
+		ssize_t n = m_IsSocket ?
+					send(m_Fd, line.data() + written, line.size() - written, MSG_NOSIGNAL) :
+					write(m_Fd, line.data() + written, line.size() - written);
+		if (n <= 0) {
+			if (n < 0 and errno == EINTR)
+				continue;
+			close(m_Fd);
+			m_Fd = -1;
+			return;
+		}
+		written += n;
+	}
+}
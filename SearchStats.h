@@ -0,0 +1,104 @@
+#pragma once
+#include "Move.h"
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// counters written by a single search thread
+// each thread gets its own cache line so that incrementing them never bounces a line between cores
+struct alignas(CACHE_LINE_SIZE) ThreadSearchCounters {
+	uint64_t nodes = 0;
+	uint64_t qNodes = 0;
+	uint64_t cutoffs = 0;
+	uint64_t firstMoveCutoffs = 0;
+	uint64_t ttProbes = 0;
+	uint64_t ttHits = 0;
+	uint64_t moveGenTicks = 0;
+	uint64_t evalTicks = 0;
+	uint64_t nullMoveTries = 0;
+	uint64_t nullMoveCutoffs = 0;
+	uint64_t lateMoveReductions = 0;
+	uint64_t lateMoveResearches = 0;
+	uint64_t reverseFutilityPrunes = 0;
+	uint64_t futilityPrunes = 0;
+	uint64_t razorPrunes = 0;
+	uint64_t seePrunes = 0;
+	uint64_t nullWindowSearches = 0;
+	uint64_t pvsResearches = 0;
+	uint64_t aspirationResearches = 0;
+	int selDepth = 0;
+};
+static_assert(sizeof(ThreadSearchCounters) % CACHE_LINE_SIZE == 0);
+
+// everything we know about a finished search, built from the per-thread counters
+struct SearchStats {
+	std::string fen;
+	Move bestMove;
+	float score = 0;
+
+	// the last completed depth, and if the search was stopped before reaching the one it aimed for
+	int depth = 0;
+	bool stopped = false;
+	int selDepth = 0;
+	std::vector<uint64_t> nodesPerThread;
+	uint64_t nodes = 0;
+	uint64_t qNodes = 0;
+	double timeMs = 0;
+	double nps = 0;
+
+	// nodes^(1/depth), how many children we really searched per node on average
+	double effectiveBranchingFactor = 0;
+	// how often the first move searched was the one to produce a beta cutoff, the higher the better the ordering
+	double firstMoveCutoffRate = 0;
+	uint64_t ttProbes = 0;
+	uint64_t ttHits = 0;
+	double ttHitRate = 0;
+	double quiescenceShare = 0;
+
+	// how often each of the selective parts of the search kicked in
+	uint64_t nullMoveTries = 0;
+	uint64_t nullMoveCutoffs = 0;
+	uint64_t lateMoveReductions = 0;
+	uint64_t lateMoveResearches = 0;
+	uint64_t reverseFutilityPrunes = 0;
+	uint64_t futilityPrunes = 0;
+	uint64_t razorPrunes = 0;
+	uint64_t seePrunes = 0;
+
+	// how often a null window search failed high and had to be searched again with the full window
+	uint64_t nullWindowSearches = 0;
+	uint64_t pvsResearches = 0;
+	double pvsResearchRate = 0;
+	// how often the aspiration window at the root was too narrow
+	uint64_t aspirationResearches = 0;
+
+	// wall time split between the different parts of the search
+	double moveGenMs = 0;
+	double evalMs = 0;
+	double searchMs = 0;
+
+	// one entry per search thread
+	void Accumulate(const std::vector<ThreadSearchCounters>& counters, double ticksPerMs);
+
+	[[nodiscard]] std::string ToJson() const;
+	friend std::ostream& operator<<(std::ostream& ostream, const SearchStats& stats);
+};
+
+// writes one json object per line to a file or a socket
+// targets are a file path, "unix:/path/to/socket" or "tcp:host:port"
+class StatsWriter {
+public:
+	StatsWriter() = default;
+	StatsWriter(const StatsWriter&) = delete;
+	StatsWriter& operator=(const StatsWriter&) = delete;
+	~StatsWriter();
+
+	bool Open(const std::string& target);
+	void Close();
+	[[nodiscard]] bool IsOpen() const { return m_Fd >= 0; }
+
+	void Write(const SearchStats& stats);
+private:
+	int m_Fd = -1;
+	bool m_IsSocket = false;
+	std::mutex m_Mutex;
+};
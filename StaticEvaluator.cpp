@@ -1,9 +1,171 @@
 #include "pch.h"
 #include "StaticEvaluator.h"
+#include "Bitbases.h"
+
+#include <immintrin.h>
+
+namespace {
+	// piece indices: 0 is an empty square, 1 to 6 the white pawn, knight, bishop, rook, queen and king, 7 to 12 the black ones
+	constexpr int PIECE_INDEX_COUNT = 13;
+	constexpr std::string_view INDEXED_PIECES = " PNBRQKpnbrqk";
+
+	consteval std::array<uint8_t, 128> GeneratePieceIndices() {
+		std::array<uint8_t, 128> indices{};
+		for (uint8_t index = 1; index < PIECE_INDEX_COUNT; index++)
+			indices[INDEXED_PIECES[index]] = index;
+		return indices;
+	}
+	constexpr std::array<uint8_t, 128> PIECE_INDEX = GeneratePieceIndices();
+
+	// material of each piece index in pawns, negative for black
+	consteval std::array<int8_t, 16> GenerateMaterial() {
+		std::array<int8_t, 16> material{};
+		for (int index = 1; index < PIECE_INDEX_COUNT; index++)
+			material[index] = (int8_t)((index <= 6 ? 1 : -1) * StaticEvaluator::PieceValue(INDEXED_PIECES[index]));
+		return material;
+	}
+	alignas(16) constexpr std::array<int8_t, 16> MATERIAL = GenerateMaterial();
+
+	// piece-square bonuses in centipawns for white, in RawBoard order so a8 comes first
+	// https://www.chessprogramming.org/Simplified_Evaluation_Function
+	typedef std::array<int8_t, 64> SquareTable;
+	constexpr std::array<SquareTable, 6> WHITE_SQUARE_TABLES = {{
+		{ // pawn
+			 0,  0,  0,  0,  0,  0,  0,  0,
+			50, 50, 50, 50, 50, 50, 50, 50,
+			10, 10, 20, 30, 30, 20, 10, 10,
+			 5,  5, 10, 25, 25, 10,  5,  5,
+			 0,  0,  0, 20, 20,  0,  0,  0,
+			 5, -5,-10,  0,  0,-10, -5,  5,
+			 5, 10, 10,-20,-20, 10, 10,  5,
+			 0,  0,  0,  0,  0,  0,  0,  0
+		}, { // knight
+			-50,-40,-30,-30,-30,-30,-40,-50,
+			-40,-20,  0,  0,  0,  0,-20,-40,
+			-30,  0, 10, 15, 15, 10,  0,-30,
+			-30,  5, 15, 20, 20, 15,  5,-30,
+			-30,  0, 15, 20, 20, 15,  0,-30,
+			-30,  5, 10, 15, 15, 10,  5,-30,
+			-40,-20,  0,  5,  5,  0,-20,-40,
+			-50,-40,-30,-30,-30,-30,-40,-50
+		}, { // bishop
+			-20,-10,-10,-10,-10,-10,-10,-20,
+			-10,  0,  0,  0,  0,  0,  0,-10,
+			-10,  0,  5, 10, 10,  5,  0,-10,
+			-10,  5,  5, 10, 10,  5,  5,-10,
+			-10,  0, 10, 10, 10, 10,  0,-10,
+			-10, 10, 10, 10, 10, 10, 10,-10,
+			-10,  5,  0,  0,  0,  0,  5,-10,
+			-20,-10,-10,-10,-10,-10,-10,-20
+		}, { // rook
+			 0,  0,  0,  0,  0,  0,  0,  0,
+			 5, 10, 10, 10, 10, 10, 10,  5,
+			-5,  0,  0,  0,  0,  0,  0, -5,
+			-5,  0,  0,  0,  0,  0,  0, -5,
+			-5,  0,  0,  0,  0,  0,  0, -5,
+			-5,  0,  0,  0,  0,  0,  0, -5,
+			-5,  0,  0,  0,  0,  0,  0, -5,
+			 0,  0,  0,  5,  5,  0,  0,  0
+		}, { // queen
+			-20,-10,-10, -5, -5,-10,-10,-20,
+			-10,  0,  0,  0,  0,  0,  0,-10,
+			-10,  0,  5,  5,  5,  5,  0,-10,
+			 -5,  0,  5,  5,  5,  5,  0, -5,
+			  0,  0,  5,  5,  5,  5,  0, -5,
+			-10,  5,  5,  5,  5,  5,  0,-10,
+			-10,  0,  5,  0,  0,  0,  0,-10,
+			-20,-10,-10, -5, -5,-10,-10,-20
+		}, { // king, kept behind its pawns
+			-30,-40,-40,-50,-50,-40,-40,-30,
+			-30,-40,-40,-50,-50,-40,-40,-30,
+			-30,-40,-40,-50,-50,-40,-40,-30,
+			-30,-40,-40,-50,-50,-40,-40,-30,
+			-20,-30,-30,-40,-40,-30,-30,-20,
+			-10,-20,-20,-20,-20,-20,-20,-10,
+			 20, 20,  0,  0,  0,  0, 20, 20,
+			 20, 30, 10,  0,  0, 10, 30, 20
+		}
+	}};
+
+	// the black tables are the white ones mirrored vertically and negated
+	consteval std::array<SquareTable, PIECE_INDEX_COUNT> GenerateSquareTables() {
+		std::array<SquareTable, PIECE_INDEX_COUNT> tables{};
+		for (int type = 0; type < 6; type++)
+			for (int square = 0; square < 64; square++) {
+				tables[1 + type][square] = WHITE_SQUARE_TABLES[type][square];
+				tables[7 + type][square] = (int8_t)-WHITE_SQUARE_TABLES[type][square ^ 56];
+			}
+		return tables;
+	}
+	alignas(32) constexpr std::array<SquareTable, PIECE_INDEX_COUNT> SQUARE_TABLES = GenerateSquareTables();
+}
+
+int StaticEvaluator::ScoreRawBoardScalar(const RawBoard& board) {
+	int material = 0;
+	int placement = 0;
+	for (int square = 0; square < 64; square++) {
+		uint8_t index = PIECE_INDEX[board[square] & 0x7f];
+		material += MATERIAL[index];
+		placement += SQUARE_TABLES[index][square];
+	}
+	return material * 100 + placement;
+}
+
+#ifdef __AVX2__
+int StaticEvaluator::ScoreRawBoardAvx2(const RawBoard& board) {
+	// the piece letters are told apart by their low 5 bits, the case bit gives the color
+	// letters with bit 4 clear (B, K, N and the empty square) are looked up by their low nibble in one table,
+	// the ones with it set (P, Q, R) in the other
+	const __m256i lowLetters = _mm256_setr_epi8(
+		0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 2, 0,
+		0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 2, 0);
+	const __m256i highLetters = _mm256_setr_epi8(
+		1, 5, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 5, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i material = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(MATERIAL.data())));
+	const __m256i ones8 = _mm256_set1_epi8(1);
+	const __m256i ones16 = _mm256_set1_epi16(1);
+
+	__m256i materialSum = _mm256_setzero_si256();
+	__m256i placementSum = _mm256_setzero_si256();
+	for (int half = 0; half < 2; half++) {
+		__m256i letters = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(board.data() + 32 * half));
+
+		// the letters are ascii, so their high bit is clear and the shuffles only look at the low nibble
+		__m256i high = _mm256_cmpeq_epi8(_mm256_and_si256(letters, _mm256_set1_epi8(0x10)), _mm256_set1_epi8(0x10));
+		__m256i type = _mm256_blendv_epi8(_mm256_shuffle_epi8(lowLetters, letters), _mm256_shuffle_epi8(highLetters, letters), high);
+		__m256i black = _mm256_cmpeq_epi8(_mm256_and_si256(letters, _mm256_set1_epi8(0x20)), _mm256_set1_epi8(0x20));
+		__m256i occupied = _mm256_cmpgt_epi8(type, _mm256_setzero_si256());
+		__m256i index = _mm256_add_epi8(type, _mm256_and_si256(_mm256_and_si256(black, occupied), _mm256_set1_epi8(6)));
+
+		// sum bytes in pairs into 16 bits and those in pairs into 32
+		__m256i pieceMaterial = _mm256_shuffle_epi8(material, index);
+		materialSum = _mm256_add_epi32(materialSum, _mm256_madd_epi16(_mm256_maddubs_epi16(ones8, pieceMaterial), ones16));
+
+		// every square holds at most one piece, so the bonuses of all the pieces can be merged with an or
+		__m256i placement = _mm256_setzero_si256();
+		for (int piece = 1; piece < PIECE_INDEX_COUNT; piece++) {
+			__m256i table = _mm256_load_si256(reinterpret_cast<const __m256i*>(SQUARE_TABLES[piece].data() + 32 * half));
+			__m256i mask = _mm256_cmpeq_epi8(index, _mm256_set1_epi8((char)piece));
+			placement = _mm256_or_si256(placement, _mm256_and_si256(mask, table));
+		}
+		placementSum = _mm256_add_epi32(placementSum, _mm256_madd_epi16(_mm256_maddubs_epi16(ones8, placement), ones16));
+	}
+
+	// material * 100 + placement in every lane, then the 8 lanes are added up
+	__m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(materialSum, _mm256_set1_epi32(100)), placementSum);
+	__m128i lanes = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, _MM_SHUFFLE(1, 0, 3, 2)));
+	lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(lanes);
+}
+#endif
 
 // the static eval is from the perspective of the current player
-Score StaticEvaluator::Evaluate(const Board& board) {
+template<BoardRepresentation B>
+Score StaticEvaluator::Evaluate(const B& board) {
 	PROFILE_SCOPE;
+	PERF_PHASE(SearchPhase::Evaluation);
 	if (board.GetLegalMoves().empty()) {
 		// checkmate
 		if (board.IsCheck())
@@ -13,28 +175,66 @@ Score StaticEvaluator::Evaluate(const Board& board) {
 			return 0.f;
 	}
 
-	return DefaultEvaluation(board);
+	// the endings of the bitbases are known, the score only has to lead the search to the mate
+	if (std::optional<Bitbases::Wdl> wdl = Bitbases::Probe(board)) {
+		if (wdl == Bitbases::Wdl::Draw)
+			return 0.f;
+		Score score = KNOWN_WIN + MopUp(board);
+		return wdl == Bitbases::Wdl::Win ? score : -score;
+	}
+
+	return board.IsWhiteTurn() ? DefaultEvaluation<Player::White>(board) : DefaultEvaluation<Player::Black>(board);
+}
+
+template<BoardRepresentation B>
+Score StaticEvaluator::MopUp(const B& board) {
+	using namespace AttackTables;
+	int kings[2] = {-1, -1};
+	int piece = -1;
+	for (int i = 0; i < B::SIZE * B::SIZE; i++) {
+		if (board[i] == 'K' or board[i] == 'k')
+			kings[board[i] == 'k'] = i;
+		else if (board[i] != ' ')
+			piece = i;
+	}
+	bool whiteWins = 'A' <= board[piece] and board[piece] <= 'Z';
+	int strongKing = kings[not whiteWins];
+	int weakKing = kings[whiteWins];
+
+	// the further from the center the weak king is and the closer the strong one, the closer the mate
+	auto centerDistance = [](int square) {
+		return std::max(3 - Col(square), Col(square) - 4) + std::max(3 - Row(square), Row(square) - 4);
+	};
+	int kingDistance = std::abs(Col(strongKing) - Col(weakKing)) + std::abs(Row(strongKing) - Row(weakKing));
+	Score score = PieceValue(board[piece]) + 0.1f * (Score)centerDistance(weakKing) + 0.05f * (Score)(14 - kingDistance);
+	if (board[piece] == 'P')
+		score += 0.1f * (Score)Row(piece);
+	else if (board[piece] == 'p')
+		score += 0.1f * (Score)(7 - Row(piece));
+	return score;
 }
 
 // always returns a score from the perspective of the current player
-Score StaticEvaluator::DefaultEvaluation(const Board& board) {
-	Score score = 0;
-	for (int i = 0; i < Board::SIZE * Board::SIZE; i++) {
-		switch (board[i]) {
-			case 'Q': score += 9; break;
-			case 'R': score += 5; break;
-			case 'B':
-			case 'N': score += 3; break;
-			case 'P': score += 1; break;
-
-			case 'q': score -= 9; break;
-			case 'r': score -= 5; break;
-			case 'b':
-			case 'n': score -= 3; break;
-			case 'p': score -= 1; break;
-		}
+template<Player P, BoardRepresentation B>
+Score StaticEvaluator::DefaultEvaluation(const B& board) {
+	// the mailbox is scored in place, other representations are laid out like it first
+	int centipawns;
+	if constexpr (requires { { board.GetRawBoard() } -> std::convertible_to<const RawBoard&>; })
+		centipawns = ScoreRawBoard(board.GetRawBoard());
+	else {
+		RawBoard raw;
+		for (int i = 0; i < B::SIZE * B::SIZE; i++)
+			raw[i] = board[i];
+		centipawns = ScoreRawBoard(raw);
 	}
-	// flip the score if we need to, to ensure that the score is from the perspective of the current player
+	Score score = (Score)centipawns / 100.f;
+
 	// a positive score means that the current player is winning
-	return score * (board.IsWhiteTurn() ? 1.f : -1.f);
-}
\ No newline at end of file
+	if constexpr (P == Player::White)
+		return score;
+	else
+		return -score;
+}
+
+// the board representations the evaluation is built for
+template Score StaticEvaluator::Evaluate(const Board& board);
@@ -1,14 +1,48 @@
+#pragma once
 #include "Board.h"
 
 typedef float Score;
 
 class StaticEvaluator {
 public:
-	[[nodiscard]] static Score Evaluate(const Board& board);
+	template<BoardRepresentation B>
+	[[nodiscard]] static Score Evaluate(const B& board);
+	// material value of a piece of either color, 0 for the king and empty squares
+	[[nodiscard]] static constexpr Score PieceValue(char piece) {
+		switch (piece) {
+			case 'Q': case 'q': return 9;
+			case 'R': case 'r': return 5;
+			case 'B': case 'b':
+			case 'N': case 'n': return 3;
+			case 'P': case 'p': return 1;
+			default: return 0;
+		}
+	}
+
+	// material and piece-square score of white minus black in centipawns
+	[[nodiscard]] static int ScoreRawBoard(const RawBoard& board) {
+#ifdef __AVX2__
+		return ScoreRawBoardAvx2(board);
+#else
+		return ScoreRawBoardScalar(board);
+#endif
+	}
+	[[nodiscard]] static int ScoreRawBoardScalar(const RawBoard& board);
+#ifdef __AVX2__
+	// the 64 squares are two registers, nothing in it branches
+	[[nodiscard]] static int ScoreRawBoardAvx2(const RawBoard& board);
+#endif
 
 	constexpr static Score LOSS = -1000;
 	constexpr static Score WIN =   1000;
 private:
-	[[nodiscard]] static Score DefaultEvaluation(const Board& board);
+	template<Player P, BoardRepresentation B>
+	[[nodiscard]] static Score DefaultEvaluation(const B& board);
+	// for the side that wins a bitbase ending: drives the other king to the edge and promotes the pawn
+	template<BoardRepresentation B>
+	[[nodiscard]] static Score MopUp(const B& board);
+
+	// a won bitbase ending scores above any material but below the mates
+	constexpr static Score KNOWN_WIN = 50;
 	float m_LegalMovesNumWeight = 0.5f;
 };
@@ -0,0 +1,290 @@
+#include "pch.h"
+#include "Book.h"
+#include "Engine.h"
+#include "Pgn.h"
+#include "ThreadPool.h"
+
+#include <filesystem>
+#include <fstream>
+
+// the checks of the parts that are easy to get wrong without noticing, run by ctest
+// every test throws on its first failed check, the others still run
+namespace {
+	struct Failure : std::runtime_error {
+		using std::runtime_error::runtime_error;
+	};
+
+	#define CHECK(condition) \
+		do { \
+			if (not (condition)) \
+				throw Failure(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": " + #condition); \
+		} while (false)
+
+	void SkipSpace(std::string_view& text) {
+		while (not text.empty() and std::isspace((unsigned char)text.front()))
+			text.remove_prefix(1);
+	}
+
+	bool Consume(std::string_view& text, char c) {
+		SkipSpace(text);
+		if (text.empty() or text.front() != c)
+			return false;
+		text.remove_prefix(1);
+		return true;
+	}
+
+	bool SkipJsonString(std::string_view& text) {
+		SkipSpace(text);
+		if (text.empty() or text.front() != '"')
+			return false;
+		for (size_t i = 1; i < text.size(); i++) {
+			if (text[i] == '\\')
+				i++;
+			else if (text[i] == '"') {
+				text.remove_prefix(i + 1);
+				return true;
+			}
+			else if ((unsigned char)text[i] < 0x20)
+				return false;
+		}
+		return false;
+	}
+
+	// the value at the start of the text, the text is left after it, false if it isn't json
+	bool SkipJsonValue(std::string_view& text) {
+		SkipSpace(text);
+		if (text.empty())
+			return false;
+		char open = text.front();
+		if (open == '{' or open == '[') {
+			char close = open == '{' ? '}' : ']';
+			text.remove_prefix(1);
+			if (Consume(text, close))
+				return true;
+			do {
+				if (open == '{' and not (SkipJsonString(text) and Consume(text, ':')))
+					return false;
+				if (not SkipJsonValue(text))
+					return false;
+			} while (Consume(text, ','));
+			return Consume(text, close);
+		}
+		if (open == '"')
+			return SkipJsonString(text);
+		for (std::string_view literal : {"true", "false", "null"})
+			if (text.starts_with(literal)) {
+				text.remove_prefix(literal.size());
+				return true;
+			}
+		double number;
+		auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+		if (error != std::errc())
+			return false;
+		text.remove_prefix(end - text.data());
+		return true;
+	}
+
+	bool IsJson(std::string_view text) {
+		if (not SkipJsonValue(text))
+			return false;
+		SkipSpace(text);
+		return text.empty();
+	}
+
+	// a game from a position that can't be read is an error, and the games around it are still read
+	void PgnBadFen() {
+		const std::string text =
+			"[Event \"a\"]\n\n1. e4 e5 1-0\n\n"
+			"[Event \"b\"]\n[SetUp \"1\"]\n[FEN \"not a fen\"]\n\n1. e4 1-0\n\n"
+			"[Event \"c\"]\n[SetUp \"1\"]\n[FEN \"also/not/a/fen w - - 0 1\"]\n\n*\n\n"
+			"[Event \"d\"]\n\n1. d4 d5 0-1\n";
+		std::vector<std::string> events;
+		Pgn::ReadStats stats = Pgn::Read(text, 1, [&events](const Pgn::Game& game, size_t) {
+			events.push_back(*game.GetTag("Event"));
+		});
+		CHECK(stats.games == 2);
+		CHECK(stats.errors == 2);
+		CHECK((events == std::vector<std::string>{"a", "d"}));
+	}
+
+	// a throwing task neither kills its worker nor leaves Wait hanging, the first exception comes out of Wait
+	void ThreadPoolException() {
+		ThreadPool pool(2);
+		std::atomic<int> done = 0;
+		for (int i = 0; i < 100; i++)
+			pool.Submit([&done, i] {
+				if (i % 10 == 3)
+					throw std::runtime_error("task " + std::to_string(i));
+				done++;
+			});
+		bool thrown = false;
+		try {
+			pool.Wait();
+		}
+		catch (const std::runtime_error& exception) {
+			thrown = std::string_view(exception.what()).starts_with("task ");
+		}
+		CHECK(thrown);
+		CHECK(done == 90);
+
+		// the exception is reported once, and the pool keeps working
+		pool.Submit([&done] { done++; });
+		pool.Wait();
+		CHECK(done == 91);
+	}
+
+	// a task waits on a batch of its own, even with the only worker of the pool
+	void ThreadPoolNestedBatch() {
+		ThreadPool pool(1);
+		std::atomic<int> done = 0;
+		ThreadPool::Batch outer(pool);
+		for (int i = 0; i < 4; i++)
+			outer.Submit([&pool, &done] {
+				ThreadPool::Batch inner(pool);
+				for (int j = 0; j < 10; j++)
+					inner.Submit([&done] { done++; });
+				inner.Wait();
+			});
+		outer.Wait();
+		CHECK(done == 40);
+	}
+
+	// a batch is done while a task of another batch of the pool is still running, and only it gets its exception
+	void ThreadPoolIndependentBatches() {
+		ThreadPool pool(2);
+		std::atomic_bool started = false;
+		std::atomic_bool release = false;
+		ThreadPool::Batch slow(pool);
+		slow.Submit([&started, &release] {
+			started = true;
+			while (not release)
+				std::this_thread::yield();
+		});
+		while (not started)
+			std::this_thread::yield();
+
+		std::atomic<int> done = 0;
+		ThreadPool::Batch fast(pool);
+		for (int i = 0; i < 10; i++)
+			fast.Submit([&done] { done++; });
+		fast.Submit([] { throw std::runtime_error("fast"); });
+		bool thrown = false;
+		try {
+			fast.Wait();
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		CHECK(done == 10);
+
+		release = true;
+		slow.Wait();
+	}
+
+	// thinking in the background searches on every thread of the engine, and StopThinking leaves a move
+	void EngineThink() {
+		Chess chess("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		Engine engine(chess, 2);
+		engine.SetVerbose(false);
+		engine.Think();
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		engine.StopThinking();
+		const SearchStats& stats = engine.GetLastStats();
+		CHECK(stats.nodesPerThread.size() == 2);
+		CHECK(std::ranges::all_of(stats.nodesPerThread, [](uint64_t nodes) { return nodes > 0; }));
+		CHECK(std::ranges::count(chess.GetBoard().GetLegalMoves(), stats.bestMove) == 1);
+	}
+
+	// every traced scope of every thread is an event of the chrome trace, which has to be json to load at all
+	void TimerChromeTrace() {
+		Timer::Reset();
+		Timer::SetEnabled(true);
+		Timer::SetTracing(true);
+		ScopeId id = Timer::Register("TraceTest");
+		auto traced = [id] {
+			Timer timer(id);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		};
+		traced();
+		traced();
+		std::thread(traced).join();
+		Timer::SetTracing(false);
+		Timer::SetEnabled(false);
+
+		std::stringstream ss;
+		Timer::ExportChromeTrace(ss);
+		std::string trace = ss.str();
+		Timer::Reset();
+		CHECK(IsJson(trace));
+		CHECK(trace.starts_with("{\"traceEvents\":["));
+		size_t events = 0;
+		for (size_t at = 0; (at = trace.find("{\"name\":\"TraceTest\",\"ph\":\"X\"", at)) != std::string::npos; at++)
+			events++;
+		CHECK(events == 3);
+	}
+
+	// a book is read back with the moves it was built from, and a file without the header of the engine's books is refused
+	void BookHeader() {
+		std::filesystem::path directory = std::filesystem::temp_directory_path();
+		std::string pgnPath = (directory / "chess_tests_book.pgn").string();
+		std::string bookPath = (directory / "chess_tests_book.bin").string();
+		{
+			std::ofstream pgn(pgnPath);
+			for (int i = 0; i < 3; i++)
+				pgn << "[Event \"" << i << "\"]\n\n1. e4 e5 2. Nf3 1-0\n\n";
+		}
+		Book::BuildStats stats = Book::Build(pgnPath, bookPath, {});
+		CHECK(stats.games == 3);
+		CHECK(stats.entries == 2);
+
+		Book::Reader book(bookPath);
+		CHECK(book.GetEntryCount() == 2);
+		Board board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+		std::vector<Book::BookMove> moves = book.GetMoves(board);
+		CHECK(moves.size() == 1);
+		CHECK(Move2Chess(moves.front().move) == "e2e4");
+
+		// the entries alone, as a book of the polyglot layout would be
+		{
+			std::ofstream file(bookPath, std::ios::binary | std::ios::trunc);
+			file << std::string(2 * Book::Reader::ENTRY_SIZE, '\0');
+		}
+		bool refused = false;
+		try {
+			Book::Reader entries(bookPath);
+		}
+		catch (const std::runtime_error&) {
+			refused = true;
+		}
+		CHECK(refused);
+		std::filesystem::remove(pgnPath);
+		std::filesystem::remove(bookPath);
+	}
+
+	const std::vector<std::pair<const char*, void (*)()>> TESTS = {
+		{"PgnBadFen", PgnBadFen},
+		{"ThreadPoolException", ThreadPoolException},
+		{"ThreadPoolNestedBatch", ThreadPoolNestedBatch},
+		{"ThreadPoolIndependentBatches", ThreadPoolIndependentBatches},
+		{"EngineThink", EngineThink},
+		{"TimerChromeTrace", TimerChromeTrace},
+		{"BookHeader", BookHeader},
+	};
+}
+
+int main() {
+	int failed = 0;
+	for (const auto& [name, test] : TESTS) {
+		try {
+			test();
+			std::cout << "ok      " << name << std::endl;
+		}
+		catch (const std::exception& exception) {
+			std::cout << "FAILED  " << name << ": " << exception.what() << std::endl;
+			failed++;
+		}
+	}
+	std::cout << TESTS.size() - failed << "/" << TESTS.size() << " passed" << std::endl;
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+namespace {
+	thread_local const ThreadPool* t_Pool = nullptr;
+	thread_local int t_WorkerIndex = -1;
+
+	// rounds of looking for work before going to sleep
+	constexpr int SPIN_ROUNDS = 64;
+}
+
+ThreadPool::ThreadPool(size_t threads, std::function<void(int)> onStart) {
+	threads = std::max<size_t>(1, threads);
+	for (size_t i = 0; i < threads; i++)
+		m_Workers.push_back(std::make_unique<Worker>());
+
+	// every deque exists before any worker starts stealing
+	for (size_t i = 0; i < threads; i++)
+		m_Workers[i]->thread = std::thread(&ThreadPool::WorkerLoop, this, (int)i, onStart);
+}
+
+ThreadPool::~ThreadPool() {
+	// an exception nobody waited for dies with the pool
+	Drain();
+	m_ShuttingDown = true;
+	m_Epoch.fetch_add(1);
+	m_Epoch.notify_all();
+	for (auto& worker : m_Workers)
+		worker->thread.join();
+}
+
+int ThreadPool::GetWorkerIndex() const {
+	return t_Pool == this ? t_WorkerIndex : -1;
+}
+
+void ThreadPool::Submit(Task task) {
+	Push(nullptr, std::move(task));
+}
+
+void ThreadPool::Push(Batch* batch, Task task) {
+	m_Pending.fetch_add(1);
+	if (batch)
+		batch->m_Pending.fetch_add(1);
+	auto* job = new Job{std::move(task), batch};
+
+	int index = GetWorkerIndex();
+	if (index >= 0)
+		m_Workers[index]->deque.Push(job);
+	else {
+		std::lock_guard lock(m_SharedMutex);
+		m_Shared.push_back(job);
+		m_SharedSize.store(m_Shared.size());
+	}
+	WakeOne();
+}
+
+void ThreadPool::WakeOne() {
+	// a worker going to sleep registers first and checks for work after, so it either sees the task or gets woken
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_Sleeping.load() > 0) {
+		m_Epoch.fetch_add(1);
+		m_Epoch.notify_one();
+	}
+}
+
+void ThreadPool::Wait() {
+	Drain();
+	std::exception_ptr error;
+	{
+		std::lock_guard lock(m_ErrorMutex);
+		std::swap(error, m_Error);
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void ThreadPool::Drain() {
+	int index = GetWorkerIndex();
+	while (true) {
+		int64_t pending = m_Pending.load();
+		if (pending == 0)
+			return;
+		if (Job* job = FindJob(index))
+			Run(job);
+		else
+			m_Pending.wait(pending);
+	}
+}
+
+ThreadPool::Batch::~Batch() {
+	Drain();
+}
+
+void ThreadPool::Batch::Submit(Task task) {
+	m_Pool.Push(this, std::move(task));
+}
+
+void ThreadPool::Batch::Wait() {
+	Drain();
+	std::exception_ptr error;
+	{
+		std::lock_guard lock(m_ErrorMutex);
+		std::swap(error, m_Error);
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void ThreadPool::Batch::Drain() {
+	int index = m_Pool.GetWorkerIndex();
+	while (true) {
+		// read before the count, so a batch done in between changes it and the wait returns
+		uint32_t done = m_Pool.m_BatchesDone.load();
+		if (m_Pending.load() == 0)
+			return;
+		// any task of the pool, the ones of the batch may be behind the others
+		if (Job* job = m_Pool.FindJob(index))
+			m_Pool.Run(job);
+		else
+			m_Pool.m_BatchesDone.wait(done);
+	}
+}
+
+ThreadPool::Job* ThreadPool::FindJob(int index) {
+	if (index >= 0)
+		if (auto job = m_Workers[index]->deque.Pop())
+			return job.value();
+
+	if (m_SharedSize.load(std::memory_order_relaxed) > 0) {
+		std::lock_guard lock(m_SharedMutex);
+		if (not m_Shared.empty()) {
+			Job* job = m_Shared.front();
+			m_Shared.pop_front();
+			m_SharedSize.store(m_Shared.size());
+			return job;
+		}
+	}
+
+	// start at a different victim for every thief so they don't all fight over the same deque
+	size_t count = m_Workers.size();
+	size_t start = index >= 0 ? (size_t)index + 1 : 0;
+	for (size_t i = 0; i < count; i++) {
+		size_t victim = (start + i) % count;
+		if ((int)victim == index)
+			continue;
+		if (auto job = m_Workers[victim]->deque.Steal())
+			return job.value();
+	}
+	return nullptr;
+}
+
+void ThreadPool::Run(Job* job) {
+	Batch* batch = job->batch;
+	try {
+		job->task();
+	}
+	catch (...) {
+		std::lock_guard lock(batch ? batch->m_ErrorMutex : m_ErrorMutex);
+		std::exception_ptr& error = batch ? batch->m_Error : m_Error;
+		if (not error)
+			error = std::current_exception();
+	}
+	delete job;
+	// the batch may be gone as soon as its count is down, so it isn't touched after that
+	if (batch and batch->m_Pending.fetch_sub(1) == 1) {
+		m_BatchesDone.fetch_add(1);
+		m_BatchesDone.notify_all();
+	}
+	if (m_Pending.fetch_sub(1) == 1)
+		m_Pending.notify_all();
+}
+
+void ThreadPool::WorkerLoop(int index, const std::function<void(int)>& onStart) {
+	t_Pool = this;
+	t_WorkerIndex = index;
+	if (onStart)
+		onStart(index);
+
+	while (not m_ShuttingDown.load(std::memory_order_relaxed)) {
+		Job* job = nullptr;
+		for (int round = 0; round < SPIN_ROUNDS and not job; round++) {
+			job = FindJob(index);
+			if (not job)
+				std::this_thread::yield();
+		}
+		if (job) {
+			Run(job);
+			continue;
+		}
+
+		// register as sleeping, then look once more so a task submitted in between isn't missed
+		m_Sleeping.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint32_t epoch = m_Epoch.load();
+		job = FindJob(index);
+		if (not job and not m_ShuttingDown.load())
+			m_Epoch.wait(epoch);
+		m_Sleeping.fetch_sub(1);
+		if (job)
+			Run(job);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "WorkStealingDeque.h"
+
+// long lived workers that each own a work stealing deque
+// tasks submitted by a worker go to its own deque without any lock, the others are stolen when a worker runs dry
+// tasks submitted from outside the pool go through a shared queue, which is the only lock
+// idle workers sleep on an atomic, so waking one doesn't go through a mutex either
+class ThreadPool {
+public:
+	typedef std::function<void()> Task;
+
+	// onStart is called by every worker before it runs any task, with its index
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency(),
+						std::function<void(int)> onStart = nullptr);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	// tasks that are waited on together, apart from the other tasks of the pool
+	// so the callers sharing a pool don't wait for each other, and a task may wait on a batch of its own
+	class Batch {
+	public:
+		explicit Batch(ThreadPool& pool) : m_Pool(pool) {}
+		Batch(const Batch&) = delete;
+		Batch& operator=(const Batch&) = delete;
+		// waits for the tasks that are left, their exception is dropped
+		~Batch();
+
+		void Submit(Task task);
+		// blocks until every task of the batch is done, the caller runs tasks of the pool itself while it waits
+		// the first exception of a task of the batch is rethrown here, the tasks after it still run
+		// must not be called from a task of the batch itself
+		void Wait();
+	private:
+		friend class ThreadPool;
+
+		void Drain();
+
+		ThreadPool& m_Pool;
+		std::atomic<int64_t> m_Pending = 0;
+		std::mutex m_ErrorMutex;
+		std::exception_ptr m_Error;
+	};
+
+	// a task of no batch
+	void Submit(Task task);
+	// blocks until every task of the pool is done, those of the batches too, the caller runs tasks itself while it waits
+	// a task that throws doesn't take its worker down, the first exception of a task of no batch is rethrown here
+	// must not be called from a worker, the task calling it is never done, a task waits on a batch instead
+	void Wait();
+
+	[[nodiscard]] size_t GetThreadCount() const { return m_Workers.size(); }
+	// index of the worker of this pool running the caller, -1 from any other thread
+	[[nodiscard]] int GetWorkerIndex() const;
+private:
+	struct Job {
+		Task task;
+		Batch* batch;
+	};
+
+	struct Worker {
+		std::thread thread;
+		WorkStealingDeque<Job*> deque;
+	};
+
+	void WorkerLoop(int index, const std::function<void(int)>& onStart);
+	// the own deque first, then the shared queue, then the other workers
+	Job* FindJob(int index);
+	void Push(Batch* batch, Task task);
+	void Run(Job* job);
+	void WakeOne();
+	// Wait without the rethrow
+	void Drain();
+
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+
+	std::mutex m_SharedMutex;
+	std::deque<Job*> m_Shared;
+	std::atomic<size_t> m_SharedSize = 0;
+
+	// bumped every time there is new work, the sleeping workers wait on it changing
+	alignas(64) std::atomic<uint32_t> m_Epoch = 0;
+	std::atomic<int> m_Sleeping = 0;
+	alignas(64) std::atomic<int64_t> m_Pending = 0;
+	// bumped every time a batch is done, its waiters wait on this and not on the batch, which is gone once they return
+	std::atomic<uint32_t> m_BatchesDone = 0;
+	std::atomic_bool m_ShuttingDown = false;
+
+	std::mutex m_ErrorMutex;
+	std::exception_ptr m_Error;
+};
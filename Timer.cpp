@@ -1,3 +1,138 @@
+#include "pch.h"
 #include "Timer.h"
 
-std::unordered_map<std::string, std::pair<long, int>> Timer::s_Duration;
\ No newline at end of file
+std::atomic_bool Timer::s_Enabled = false;
+std::atomic_bool Timer::s_Tracing = false;
+std::mutex Timer::s_RegistryMutex;
+std::vector<std::string> Timer::s_ScopeNames;
+std::vector<std::unique_ptr<Timer::ThreadProfile>> Timer::s_Threads;
+
+// reference point used to convert tsc ticks to wall clock time
+static const uint64_t s_CalibrationTicks = Timer::ReadTicks();
+static const auto s_CalibrationTime = std::chrono::steady_clock::now();
+
+void Timer::Stop() {
+	uint64_t end = ReadTicks();
+	ThreadProfile& profile = GetThreadProfile();
+	ScopeStats& stats = profile.scopes[m_Id];
+
+	// only the owning thread writes these counters, no need for a read-modify-write
+	stats.ticks.store(stats.ticks.load(std::memory_order_relaxed) + end - m_Start, std::memory_order_relaxed);
+	stats.calls.store(stats.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	if (IsTracing()) {
+		std::lock_guard lock(profile.eventsMutex);
+		profile.events.push_back({m_Id, m_Start, end});
+	}
+	m_Start = 0;
+}
+
+ScopeId Timer::Register(const char* name) {
+	std::lock_guard lock(s_RegistryMutex);
+	auto it = std::find(s_ScopeNames.begin(), s_ScopeNames.end(), name);
+	if (it != s_ScopeNames.end())
+		return (ScopeId)(it - s_ScopeNames.begin());
+
+	// every scope over the limit shares the last slot
+	if (s_ScopeNames.size() == MAX_SCOPES - 1)
+		s_ScopeNames.emplace_back("<other>");
+	if (s_ScopeNames.size() >= MAX_SCOPES)
+		return MAX_SCOPES - 1;
+
+	s_ScopeNames.emplace_back(name);
+	return (ScopeId)(s_ScopeNames.size() - 1);
+}
+
+Timer::ThreadProfile& Timer::GetThreadProfile() {
+	thread_local ThreadProfile* t_Profile = nullptr;
+	if (t_Profile)
+		return *t_Profile;
+
+	std::lock_guard lock(s_RegistryMutex);
+	s_Threads.push_back(std::make_unique<ThreadProfile>());
+	t_Profile = s_Threads.back().get();
+	t_Profile->threadIndex = (int)s_Threads.size() - 1;
+	return *t_Profile;
+}
+
+double Timer::TicksPerMicrosecond() {
+	// make sure enough time passed since the calibration point for the ratio to be precise
+	auto elapsed = std::chrono::steady_clock::now() - s_CalibrationTime;
+	if (elapsed < std::chrono::milliseconds(10)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+		elapsed = std::chrono::steady_clock::now() - s_CalibrationTime;
+	}
+	uint64_t ticks = ReadTicks() - s_CalibrationTicks;
+	auto us = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(elapsed).count();
+	return static_cast<double>(ticks) / us;
+}
+
+double Timer::GetMilliseconds(ScopeId id) {
+	uint64_t ticks = 0;
+	{
+		std::lock_guard lock(s_RegistryMutex);
+		for (const auto& profile : s_Threads)
+			ticks += profile->scopes[id].ticks.load(std::memory_order_relaxed);
+	}
+	return static_cast<double>(ticks) / TicksPerMicrosecond() / 1000.0;
+}
+
+uint64_t Timer::GetCalls(ScopeId id) {
+	std::lock_guard lock(s_RegistryMutex);
+	uint64_t calls = 0;
+	for (const auto& profile : s_Threads)
+		calls += profile->scopes[id].calls.load(std::memory_order_relaxed);
+	return calls;
+}
+
+void Timer::PrintDurations() {
+	double ticksPerUs = TicksPerMicrosecond();
+	std::lock_guard lock(s_RegistryMutex);
+	for (size_t id = 0; id < s_ScopeNames.size(); id++) {
+		uint64_t ticks = 0;
+		uint64_t calls = 0;
+		for (const auto& profile : s_Threads) {
+			ticks += profile->scopes[id].ticks.load(std::memory_order_relaxed);
+			calls += profile->scopes[id].calls.load(std::memory_order_relaxed);
+		}
+		if (not calls)
+			continue;
+
+		std::cout << s_ScopeNames[id] << " " << calls << "[ct] " <<
+		(long)(static_cast<double>(ticks) / ticksPerUs / 1000.0) << "[ms]" << std::endl;
+	}
+}
+
+void Timer::ExportChromeTrace(std::ostream& ostream) {
+	double ticksPerUs = TicksPerMicrosecond();
+	std::lock_guard lock(s_RegistryMutex);
+
+	ostream << "{\"traceEvents\":[";
+	bool first = true;
+	for (const auto& profile : s_Threads) {
+		std::lock_guard eventsLock(profile->eventsMutex);
+		for (const TraceEvent& event : profile->events) {
+			// timestamps are relative to the calibration point, in microseconds
+			double ts = static_cast<double>(event.start - s_CalibrationTicks) / ticksPerUs;
+			double dur = static_cast<double>(event.end - event.start) / ticksPerUs;
+
+			ostream << (first ? "\n" : ",\n");
+			ostream << "{\"name\":\"" << s_ScopeNames[event.id] << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" <<
+			profile->threadIndex << std::fixed << std::setprecision(3) << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+			first = false;
+		}
+	}
+	ostream << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+void Timer::Reset() {
+	std::lock_guard lock(s_RegistryMutex);
+	for (const auto& profile : s_Threads) {
+		for (ScopeStats& stats : profile->scopes) {
+			stats.ticks.store(0, std::memory_order_relaxed);
+			stats.calls.store(0, std::memory_order_relaxed);
+		}
+		std::lock_guard eventsLock(profile->eventsMutex);
+		profile->events.clear();
+	}
+}
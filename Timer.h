@@ -1,52 +1,99 @@
 #include <utility>
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <x86intrin.h>
 
 #pragma once
 
 typedef std::chrono::microseconds time_unit;
+typedef uint16_t ScopeId;
 
+// scoped profiler
+// every call site is interned once into a ScopeId, and each thread accumulates
+// its own TSC tick counts so the hot path never takes a lock or touches a shared line.
+// the per-thread counters are merged when a report is requested
 class Timer {
 public:
-	explicit Timer(std::string name):
-		m_Name(std::move(name)),
-		m_Start(std::chrono::steady_clock::now())
+	explicit Timer(ScopeId id):
+		m_Id(id),
+		m_Start(IsEnabled() ? ReadTicks() : 0)
 	{}
 
 	~Timer() {
-		Stop();
+		if (m_Start)
+			Stop();
 	}
 
-	void Pause() {
-		auto end = std::chrono::steady_clock::now();
-		auto us = std::chrono::duration_cast<time_unit>(end - m_Start);
-		s_Duration[m_Name].first += us.count();
-	}
+	void Stop();
 
-	void Stop() {
-		auto end = std::chrono::steady_clock::now();
-		auto us = std::chrono::duration_cast<time_unit>(end - m_Start);
-		s_Duration[m_Name].first += us.count();
-		s_Duration[m_Name].second++;
-	}
+	// returns the id of the scope, registering it if it was never seen before
+	static ScopeId Register(const char* name);
 
-	static void PrintDurations() {
-		for (auto& [name, data]: s_Duration) {
-			std::cout << name << " " << data.second << "[ct] " <<
-			(int)(data.first / 1000) << "[ms]" << std::endl;
-		}
-	}
+	// the profiler is disabled by default, it only costs a relaxed load per scope when off
+	static void SetEnabled(bool enabled) { s_Enabled.store(enabled, std::memory_order_relaxed); }
+	[[nodiscard]] static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+	// when tracing, every scope is also recorded as an event for the chrome trace export
+	static void SetTracing(bool tracing) { s_Tracing.store(tracing, std::memory_order_relaxed); }
+	[[nodiscard]] static bool IsTracing() { return s_Tracing.load(std::memory_order_relaxed); }
+
+	// total time spent in a scope across all threads
+	[[nodiscard]] static double GetMilliseconds(ScopeId id);
+	[[nodiscard]] static uint64_t GetCalls(ScopeId id);
+
+	static void PrintDurations();
+	// writes the recorded events in the chrome://tracing (or perfetto) json format
+	static void ExportChromeTrace(std::ostream& ostream);
+	static void Reset();
+
+	[[nodiscard]] static inline uint64_t ReadTicks() { return __rdtsc(); }
+	[[nodiscard]] static double TicksPerMicrosecond();
+
+	static constexpr size_t MAX_SCOPES = 256;
 private:
-	std::string m_Name;
-	std::chrono::time_point<std::chrono::steady_clock> m_Start;
+	struct ScopeStats {
+		std::atomic<uint64_t> ticks = 0;
+		std::atomic<uint64_t> calls = 0;
+	};
 
-	// name to duration and call count
-	static std::unordered_map<std::string, std::pair<long, int>> s_Duration;
+	struct TraceEvent {
+		ScopeId id;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	// owned by the registry so the counters outlive the thread that wrote them
+	struct ThreadProfile {
+		int threadIndex = 0;
+		std::array<ScopeStats, MAX_SCOPES> scopes;
+		std::mutex eventsMutex;
+		std::vector<TraceEvent> events;
+	};
+
+	static ThreadProfile& GetThreadProfile();
+
+	ScopeId m_Id;
+	uint64_t m_Start;
+
+	static std::atomic_bool s_Enabled;
+	static std::atomic_bool s_Tracing;
+
+	// guards the scope names and the thread list, never taken on the hot path
+	static std::mutex s_RegistryMutex;
+	static std::vector<std::string> s_ScopeNames;
+	static std::vector<std::unique_ptr<ThreadProfile>> s_Threads;
 };
 
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
 # if PROFILE == 1
-	#define PROFILE_SCOPE_NAME(name) Timer timer##__LINE__(name)
-	#define PROFILE_SCOPE Timer timer##__LINE__(__FUNCTION__)
+	#define PROFILE_SCOPE_NAME(name) \
+		static const ScopeId PROFILE_CONCAT(profileId, __LINE__) = Timer::Register(name); \
+		Timer PROFILE_CONCAT(timer, __LINE__)(PROFILE_CONCAT(profileId, __LINE__))
+	#define PROFILE_SCOPE PROFILE_SCOPE_NAME(__FUNCTION__)
 #else
 	#define PROFILE_SCOPE_NAME(name)
 	#define PROFILE_SCOPE
 #endif
-
@@ -0,0 +1,265 @@
+#include "pch.h"
+#include "TranspositionTable.h"
+#include "AttackTables.h"
+#include "ThreadPool.h"
+#include "Zobrist.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	constexpr char FILE_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'T', 'T', '\0'};
+	// bumped whenever the entries, the way they are placed or the checksum change
+	constexpr uint32_t FILE_VERSION = 2;
+	// a whole page, so the buckets after it are aligned in the mapping
+	constexpr size_t FILE_HEADER_SIZE = 4096;
+
+	struct FileHeader {
+		char magic[8];
+		uint32_t version;
+		// the checksum holds for a table written by Save, a table mapped shared is being written and has none
+		uint32_t sealed;
+		uint64_t bucketCount;
+		// a table hashed with other keys is full of misses
+		uint64_t keys;
+		uint64_t checksum;
+		uint8_t generation;
+	};
+	static_assert(sizeof(FileHeader) <= FILE_HEADER_SIZE);
+
+	// fnv-1a over the words, it can be carried over from one block to the next
+	uint64_t Checksum(const void* data, size_t bytes, uint64_t checksum = 0xcbf29ce484222325ULL) {
+		const auto* words = static_cast<const uint64_t*>(data);
+		for (size_t i = 0; i < bytes / sizeof(uint64_t); i++)
+			checksum = (checksum ^ words[i]) * 0x100000001b3ULL;
+		return checksum;
+	}
+
+	// the checksum of the file is the one of the checksums of its blocks in order, so the blocks can be summed in parallel
+	constexpr size_t CHECKSUM_BLOCK_SIZE = Memory::HUGE_PAGE_SIZE;
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+	Resize(megabytes);
+}
+
+void TranspositionTable::Resize(size_t megabytes) {
+	// a power of two number of buckets so the index is a mask of the key
+	m_BucketCount = std::bit_floor(std::max<size_t>(1, megabytes * 1024 * 1024 / sizeof(Bucket)));
+	// free the old table first, both may not fit at once
+	m_Memory = {};
+	m_File = {};
+	m_Memory = Memory::LargeBuffer(m_BucketCount * sizeof(Bucket));
+	// zeroed slots are empty ones, the buckets are used as they come from the kernel
+	m_Buckets = static_cast<Bucket*>(m_Memory.Get());
+	m_Generation = 0;
+}
+
+void TranspositionTable::Clear(ThreadPool* pool) {
+	// no search is running, so the slots can be cleared as plain memory
+	auto clear = [this](size_t begin, size_t end) {
+		std::memset(static_cast<void*>(m_Buckets + begin), 0, (end - begin) * sizeof(Bucket));
+	};
+
+	size_t threads = pool ? pool->GetThreadCount() : 1;
+	// slices of whole huge pages, so no page is shared by two threads
+	size_t bucketsPerPage = Memory::HUGE_PAGE_SIZE / sizeof(Bucket);
+	size_t slice = (m_BucketCount / threads + bucketsPerPage - 1) / bucketsPerPage * bucketsPerPage;
+	if (threads == 1 or slice >= m_BucketCount)
+		clear(0, m_BucketCount);
+	else {
+		ThreadPool::Batch batch(*pool);
+		for (size_t begin = 0; begin < m_BucketCount; begin += slice)
+			batch.Submit([&clear, begin, slice, this] { clear(begin, std::min(begin + slice, m_BucketCount)); });
+		batch.Wait();
+	}
+	m_Generation = 0;
+}
+
+void TranspositionTable::Save(const std::string& path) const {
+	FileHeader header{};
+	std::ranges::copy(FILE_MAGIC, header.magic);
+	header.version = FILE_VERSION;
+	header.sealed = 1;
+	header.bucketCount = m_BucketCount;
+	header.keys = Zobrist::Fingerprint();
+	header.checksum = Checksum(nullptr, 0);
+	header.generation = m_Generation.load(std::memory_order_relaxed);
+
+	// written next to the file and renamed over it, so a process mapping it never sees half a table
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		std::vector<char> block(FILE_HEADER_SIZE);
+		file.write(block.data(), (std::streamsize)block.size());
+		// copied a block at a time, the checksum is of what was written even if the table is shared and changing
+		block.resize(CHECKSUM_BLOCK_SIZE);
+		const char* buckets = reinterpret_cast<const char*>(m_Buckets);
+		for (size_t offset = 0; offset < GetSize(); offset += block.size()) {
+			size_t bytes = std::min(block.size(), GetSize() - offset);
+			std::memcpy(block.data(), buckets + offset, bytes);
+			uint64_t blockChecksum = Checksum(block.data(), bytes);
+			header.checksum = Checksum(&blockChecksum, sizeof(blockChecksum), header.checksum);
+			file.write(block.data(), (std::streamsize)bytes);
+		}
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (not file)
+			throw std::runtime_error("could not write " + temporary);
+	}
+	std::filesystem::rename(temporary, path);
+}
+
+bool TranspositionTable::Load(const std::string& path, bool shared, ThreadPool* pool) {
+	std::error_code error;
+	if (shared and not std::filesystem::exists(path, error)) {
+		FileHeader header{};
+		std::ranges::copy(FILE_MAGIC, header.magic);
+		header.version = FILE_VERSION;
+		header.bucketCount = m_BucketCount;
+		header.keys = Zobrist::Fingerprint();
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			if (not file)
+				return false;
+		}
+		// the rest of the file reads as zeros, empty slots, and takes no space until it is written
+		std::filesystem::resize_file(path, FILE_HEADER_SIZE + GetSize(), error);
+		if (error)
+			return false;
+	}
+
+	Memory::MappedFile file;
+	try {
+		file = Memory::MappedFile(path, Memory::Access::Random, shared ? Memory::Sharing::Shared : Memory::Sharing::Private);
+	}
+	catch (const std::runtime_error&) {
+		return false;
+	}
+	if (file.GetSize() < FILE_HEADER_SIZE)
+		return false;
+
+	auto* header = reinterpret_cast<FileHeader*>(file.GetWritableData());
+	char* buckets = file.GetWritableData() + FILE_HEADER_SIZE;
+	if (not std::ranges::equal(header->magic, FILE_MAGIC) or header->version != FILE_VERSION or header->keys != Zobrist::Fingerprint() or
+		not std::has_single_bit(header->bucketCount) or file.GetSize() != FILE_HEADER_SIZE + header->bucketCount * sizeof(Bucket))
+		return false;
+	// reading every page for the checksum is the price of a sealed table, a live shared one relies on the slot checks
+	if (header->sealed) {
+		size_t size = file.GetSize() - FILE_HEADER_SIZE;
+		std::vector<uint64_t> blockChecksums((size + CHECKSUM_BLOCK_SIZE - 1) / CHECKSUM_BLOCK_SIZE);
+		auto sum = [&blockChecksums, buckets, size](size_t begin, size_t end) {
+			for (size_t block = begin; block < end; block++) {
+				size_t offset = block * CHECKSUM_BLOCK_SIZE;
+				blockChecksums[block] = Checksum(buckets + offset, std::min(CHECKSUM_BLOCK_SIZE, size - offset));
+			}
+		};
+		size_t threads = pool ? pool->GetThreadCount() : 1;
+		size_t slice = (blockChecksums.size() + threads - 1) / threads;
+		if (threads == 1 or blockChecksums.size() <= 1)
+			sum(0, blockChecksums.size());
+		else {
+			ThreadPool::Batch batch(*pool);
+			for (size_t begin = 0; begin < blockChecksums.size(); begin += slice)
+				batch.Submit([&sum, begin, slice, &blockChecksums] { sum(begin, std::min(begin + slice, blockChecksums.size())); });
+			batch.Wait();
+		}
+		if (header->checksum != Checksum(blockChecksums.data(), blockChecksums.size() * sizeof(uint64_t)))
+			return false;
+	}
+	// the search is going to write to the file, the checksum won't hold anymore
+	if (shared)
+		header->sealed = 0;
+
+	m_Memory = {};
+	m_BucketCount = header->bucketCount;
+	m_Generation = header->generation;
+	m_Buckets = reinterpret_cast<Bucket*>(buckets);
+	m_File = std::move(file);
+	return true;
+}
+
+bool TranspositionTable::Probe(uint64_t key, TTEntry& entry) const {
+	for (const Slot& slot : GetBucket(key).slots) {
+		TTEntry candidate = slot.Load();
+		if (candidate.key == key and candidate.GetBound() != Bound::None) {
+			entry = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void TranspositionTable::Store(uint64_t key, Score score, int depth, Bound bound, uint16_t move) {
+	Bucket& bucket = GetBucket(key);
+	const uint8_t generation = m_Generation.load(std::memory_order_relaxed);
+
+	// the same position is overwritten, otherwise the shallowest entry, entries of older searches count as shallower
+	auto worth = [generation](const TTEntry& e) {
+		return e.depth - 8 * ((generation - e.GetGeneration()) & 0x3f);
+	};
+	Slot* replace = &bucket.slots[0];
+	TTEntry replaced = replace->Load();
+	for (Slot& slot : bucket.slots) {
+		TTEntry entry = slot.Load();
+		if (entry.key == key) {
+			replace = &slot;
+			replaced = entry;
+			break;
+		}
+		if (worth(entry) < worth(replaced)) {
+			replace = &slot;
+			replaced = entry;
+		}
+	}
+
+	// keep the move we knew about if this search didn't find one
+	if (move == 0 and replaced.key == key)
+		move = replaced.move;
+
+	TTEntry entry{key, score, move, (int8_t)std::clamp(depth, 0, 127),
+				  (uint8_t)(static_cast<uint8_t>(bound) | (generation << 2))};
+	uint64_t data = entry.PackData();
+	replace->data.store(data, std::memory_order_relaxed);
+	replace->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::HashFull() const {
+	size_t sample = std::min<size_t>(m_BucketCount, 1000 / BUCKET_SIZE);
+	const uint8_t generation = m_Generation.load(std::memory_order_relaxed);
+	int used = 0;
+	for (size_t i = 0; i < sample; i++)
+		for (const Slot& slot : m_Buckets[i].slots) {
+			TTEntry entry = slot.Load();
+			if (entry.GetBound() != Bound::None and entry.GetGeneration() == generation)
+				used++;
+		}
+	return sample ? (int)(used * 1000 / (sample * BUCKET_SIZE)) : 0;
+}
+
+uint16_t TranspositionTable::PackMove(const Move& move) {
+	uint16_t promote = 0;
+	if (move.promote) {
+		switch (std::tolower(move.promote.value())) {
+			case 'q': promote = 1; break;
+			case 'r': promote = 2; break;
+			case 'b': promote = 3; break;
+			case 'n': promote = 4; break;
+		}
+	}
+	int from = AttackTables::Index(move.from.first, move.from.second);
+	int to = AttackTables::Index(move.to.first, move.to.second);
+	return (uint16_t)(from | to << 6 | promote << 12);
+}
+
+Move TranspositionTable::UnpackMove(uint16_t packed, bool whiteTurn) {
+	int from = packed & 0x3f;
+	int to = (packed >> 6) & 0x3f;
+	std::optional<char> promote;
+	if (int code = packed >> 12) {
+		char piece = " qrbn"[code];
+		promote = whiteTurn ? (char)std::toupper(piece) : piece;
+	}
+	return {{AttackTables::Col(from), AttackTables::Row(from)}, {AttackTables::Col(to), AttackTables::Row(to)}, promote};
+}
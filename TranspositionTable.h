@@ -0,0 +1,102 @@
+#pragma once
+#include "Move.h"
+#include "SearchStats.h"
+#include "Memory.h"
+
+class ThreadPool;
+
+typedef float Score;
+
+enum class Bound : uint8_t {
+	None, Exact, Lower, Upper
+};
+
+// what the table knows about a position
+struct TTEntry {
+	uint64_t key = 0;
+	Score score = 0;
+	uint16_t move = 0;
+	int8_t depth = 0;
+	// the bound in the low 2 bits, the generation of the search that wrote it in the rest
+	uint8_t boundAndGeneration = 0;
+
+	[[nodiscard]] Bound GetBound() const { return static_cast<Bound>(boundAndGeneration & 0x3); }
+	[[nodiscard]] uint8_t GetGeneration() const { return boundAndGeneration >> 2; }
+
+	// everything but the key in 64 bits
+	[[nodiscard]] uint64_t PackData() const {
+		return (uint64_t)std::bit_cast<uint32_t>(score) | (uint64_t)move << 32 |
+			   (uint64_t)(uint8_t)depth << 48 | (uint64_t)boundAndGeneration << 56;
+	}
+	[[nodiscard]] static TTEntry Unpack(uint64_t key, uint64_t data) {
+		return {key, std::bit_cast<Score>((uint32_t)data), (uint16_t)(data >> 32), (int8_t)(uint8_t)(data >> 48),
+				(uint8_t)(data >> 56)};
+	}
+};
+
+// hash table of searched positions, indexed by the zobrist hash of the board
+// it is shared by the search threads without locks: every slot stores the key xored with the data,
+// so a slot torn by two threads writing it at once doesn't match any key and is simply a miss
+class TranspositionTable {
+public:
+	explicit TranspositionTable(size_t megabytes = 16);
+
+	// the new table is mapped zeroed and untouched, so it doesn't need a clear
+	void Resize(size_t megabytes);
+	// the pool's threads each clear a slice, which also places the slices on their numa nodes
+	// a table mapped shared from a file is cleared for every process mapping it
+	void Clear(ThreadPool* pool = nullptr);
+
+	// writes the table after a header with the version, the size, the zobrist keys and a checksum of the entries
+	// no search may be running, throws std::runtime_error if the file can't be written
+	void Save(const std::string& path) const;
+	// maps a table written by Save in place of this one, false and nothing changes if the file is missing or fails a check
+	// a sealed table, one written by Save, is read once for its checksum, the pool's threads each sum a slice of blocks
+	// a table written live through a shared mapping has no checksum, its pages are only read as the search probes them
+	// private: the writes of the search stay in the process, shared: they go to the file, which is created at the
+	// current size if it is missing, and every engine process mapping it shares the table
+	bool Load(const std::string& path, bool shared = false, ThreadPool* pool = nullptr);
+	[[nodiscard]] bool IsMappedFromFile() const { return m_File.GetSize() > 0; }
+	// entries of older searches are replaced first
+	// engines sharing the table each start their own searches, a lost increment only makes an old entry look newer
+	void NewSearch() { m_Generation.store((m_Generation.load(std::memory_order_relaxed) + 1) & 0x3f, std::memory_order_relaxed); }
+
+	[[nodiscard]] bool Probe(uint64_t key, TTEntry& entry) const;
+	void Store(uint64_t key, Score score, int depth, Bound bound, uint16_t move);
+
+	// permille of the entries written by the current search, sampled from the first buckets
+	[[nodiscard]] int HashFull() const;
+	[[nodiscard]] size_t GetSize() const { return m_BucketCount * sizeof(Bucket); }
+	[[nodiscard]] Memory::Pages GetPages() const { return m_Memory.GetPages(); }
+
+	// a move in 16 bits: 6 bits for the origin, 6 for the destination and 3 for the promotion, 0 is no move
+	[[nodiscard]] static uint16_t PackMove(const Move& move);
+	[[nodiscard]] static Move UnpackMove(uint16_t packed, bool whiteTurn);
+private:
+	struct Slot {
+		std::atomic<uint64_t> check = 0;
+		std::atomic<uint64_t> data = 0;
+
+		[[nodiscard]] TTEntry Load() const {
+			uint64_t d = data.load(std::memory_order_relaxed);
+			return TTEntry::Unpack(check.load(std::memory_order_relaxed) ^ d, d);
+		}
+	};
+
+	// 16 bytes a slot, four of them share a cache line
+	static constexpr size_t BUCKET_SIZE = 4;
+	struct alignas(CACHE_LINE_SIZE) Bucket {
+		std::array<Slot, BUCKET_SIZE> slots;
+	};
+	static_assert(sizeof(Bucket) == CACHE_LINE_SIZE);
+
+	[[nodiscard]] const Bucket& GetBucket(uint64_t key) const { return m_Buckets[key & (m_BucketCount - 1)]; }
+	[[nodiscard]] Bucket& GetBucket(uint64_t key) { return m_Buckets[key & (m_BucketCount - 1)]; }
+
+	Memory::LargeBuffer m_Memory;
+	// the buckets are in one or the other
+	Memory::MappedFile m_File;
+	Bucket* m_Buckets = nullptr;
+	size_t m_BucketCount = 0;
+	std::atomic<uint8_t> m_Generation = 0;
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Chase-Lev deque, with the memory orderings of "Correct and Efficient Work-Stealing for Weak Memory Models"
+// only the owner pushes and pops, at the bottom, any thread can steal from the top
+// T has to be trivially copyable since it is stored in atomics, in practice it is a pointer
+template<typename T>
+class WorkStealingDeque {
+public:
+	explicit WorkStealingDeque(size_t capacity = 256) {
+		m_Arrays.push_back(std::make_unique<Array>(std::bit_ceil(capacity)));
+		m_Array.store(m_Arrays.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	// owner only
+	void Push(T item) {
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		Array* array = m_Array.load(std::memory_order_relaxed);
+
+		if (bottom - top > (int64_t)array->capacity - 1)
+			array = Grow(array, top, bottom);
+
+		array->Put(bottom, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	// owner only, takes the most recently pushed item
+	std::optional<T> Pop() {
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		Array* array = m_Array.load(std::memory_order_relaxed);
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom) {
+			// it was already empty
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return std::nullopt;
+		}
+
+		T item = array->Get(bottom);
+		if (top == bottom) {
+			// the last item, race the thieves for it
+			bool won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			if (not won)
+				return std::nullopt;
+		}
+		return item;
+	}
+
+	// any thread, takes the oldest item
+	std::optional<T> Steal() {
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return std::nullopt;
+
+		Array* array = m_Array.load(std::memory_order_acquire);
+		T item = array->Get(top);
+		if (not m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return std::nullopt;
+		return item;
+	}
+
+	[[nodiscard]] bool Empty() const {
+		return m_Top.load(std::memory_order_relaxed) >= m_Bottom.load(std::memory_order_relaxed);
+	}
+private:
+	struct Array {
+		explicit Array(size_t capacity) : capacity(capacity), mask(capacity - 1), items(new std::atomic<T>[capacity]) {}
+
+		void Put(int64_t index, T item) { items[index & mask].store(item, std::memory_order_relaxed); }
+		T Get(int64_t index) const { return items[index & mask].load(std::memory_order_relaxed); }
+
+		size_t capacity;
+		size_t mask;
+		std::unique_ptr<std::atomic<T>[]> items;
+	};
+
+	// thieves may still read the old array, so it is kept until the deque dies
+	Array* Grow(Array* array, int64_t top, int64_t bottom) {
+		m_Arrays.push_back(std::make_unique<Array>(array->capacity * 2));
+		Array* grown = m_Arrays.back().get();
+		for (int64_t i = top; i < bottom; i++)
+			grown->Put(i, array->Get(i));
+		m_Array.store(grown, std::memory_order_release);
+		return grown;
+	}
+
+	// top and bottom are written by different threads, keep them on their own lines
+	alignas(64) std::atomic<int64_t> m_Top = 0;
+	alignas(64) std::atomic<int64_t> m_Bottom = 0;
+	alignas(64) std::atomic<Array*> m_Array;
+	std::vector<std::unique_ptr<Array>> m_Arrays;
+};
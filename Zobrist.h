@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// random keys that are xored together to hash a position
+// the pieces are indexed by their PackedPosition code and the squares like the RawBoard
+namespace Zobrist {
+	constexpr uint64_t SplitMix64(uint64_t& state) {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	struct Keys {
+		std::array<std::array<uint64_t, 64>, 13> pieces{};
+		uint64_t blackToMove = 0;
+		// white king side, white queen side, black king side, black queen side
+		std::array<uint64_t, 4> castling{};
+		std::array<uint64_t, 8> enPassant{};
+	};
+
+	constexpr Keys Generate() {
+		Keys keys;
+		uint64_t state = 0x2545f4914f6cdd1dULL;
+		// code 0 is an empty square and hashes to nothing
+		for (int code = 1; code < 13; code++)
+			for (uint64_t& key : keys.pieces[code])
+				key = SplitMix64(state);
+		keys.blackToMove = SplitMix64(state);
+		for (uint64_t& key : keys.castling)
+			key = SplitMix64(state);
+		for (uint64_t& key : keys.enPassant)
+			key = SplitMix64(state);
+		return keys;
+	}
+
+	inline constexpr Keys KEYS = Generate();
+
+	// a few of the keys mixed, for the files keyed by the hash to tell the keys they were written with
+	constexpr uint64_t Fingerprint() {
+		return KEYS.pieces[1][0] ^ KEYS.pieces[12][63] ^ KEYS.blackToMove ^ KEYS.castling[3] ^ KEYS.enPassant[7];
+	}
+}
@@ -3,21 +3,265 @@
 #include "Engine.h"
 #include "NetworkHandler.h"
 #include "BoardOptimized.h"
+#include "Benchmark.h"
+#include "MateSolver.h"
+#include "Bitbases.h"
+#include "Pgn.h"
+#include "Book.h"
+#include "Daemon.h"
+#include "Annotate.h"
+#include "Epd.h"
 
-// consteval std::array<uint64_t, 64> GenerateValues() {
-// 	std::array<uint64_t, 64> values{};
-// 	for (int i = 0; i < 64; i++) {
-// 		values[i] = 1ULL << i;
-// 	}
-// 	return values;
-// }
-//
-// std::array<uint64_t, 64> values = GenerateValues();
-//
+#include <fstream>
+
+int main(int argc, char** argv) {
+	std::vector<std::string> args(argv + 1, argv + argc);
+
+	if (args.size() > 1 and args[0] == "bench" and args[1] == "formats") {
+		Benchmark::RunPositionFormats(args.size() > 2 ? std::stoi(args[2]) : 1000000);
+		return 0;
+	}
+
+	// bitbases [cache file]: builds the endgame tables, or loads them from the cache
+	if (not args.empty() and args[0] == "bitbases") {
+		if (args.size() > 1)
+			Bitbases::SetCachePath(args[1]);
+		ThreadPool pool;
+		Bitbases::Init(&pool);
+		const Bitbases::BuildStats& stats = Bitbases::GetBuildStats();
+		std::cout << (stats.fromCache ? "loaded" : "built") << " in " << stats.timeMs << "[ms]";
+		if (not stats.fromCache)
+			std::cout << ", " << stats.passes << " passes";
+		std::cout << " | wins: KQK " << stats.wins[0] << " KRK " << stats.wins[1] << " KPK " << stats.wins[2] << std::endl;
+		return 0;
+	}
+
+	// pgn <file> [--write]: reads every game of the file, --write prints them back in san on one thread in order
+	if (args.size() > 1 and args[0] == "pgn") {
+		Pgn::ReadStats stats;
+		if (args.size() > 2 and args[2] == "--write")
+			stats = Pgn::ReadFile(args[1], 1, [](const Pgn::Game& game, size_t) { Pgn::Write(std::cout, game); });
+		else {
+			ThreadPool pool;
+			stats = Pgn::ReadFile(args[1], pool.GetThreadCount() * 4, [](const Pgn::Game&, size_t) {}, &pool);
+		}
+		double seconds = std::max(stats.timeMs, 1e-3) / 1000;
+		std::cerr << stats.games << " games, " << stats.plies << " plies, " << stats.errors << " errors in " << stats.timeMs << "[ms] | "
+				  << (uint64_t)(stats.games / seconds) << " games/s, " << stats.bytes / seconds / (1 << 20) << " MB/s" << std::endl;
+		return 0;
+	}
+
+	// book build <pgn> <book> [--min-games=<n>] [--max-ply=<n>]: counts the moves of the games into an opening book
+	if (args.size() > 3 and args[0] == "book" and args[1] == "build") {
+		Book::BuildOptions options;
+		for (size_t i = 4; i < args.size(); i++) {
+			if (args[i].starts_with("--min-games="))
+				options.minGames = std::stoul(args[i].substr(12));
+			else if (args[i].starts_with("--max-ply="))
+				options.maxPly = std::stoi(args[i].substr(10));
+		}
+		ThreadPool pool;
+		Book::BuildStats stats = Book::Build(args[2], args[3], options, &pool);
+		std::cout << stats.games << " games (" << stats.skipped << " skipped) read in " << stats.readMs << "[ms], "
+				  << stats.counted << " moves counted, " << stats.entries << " entries written in " << stats.writeMs << "[ms]" << std::endl;
+		return 0;
+	}
+
+	// book probe <book> <fen>: the moves of the book for the position
+	if (args.size() > 3 and args[0] == "book" and args[1] == "probe") {
+		Book::Reader book(args[2]);
+		Board board(args[3]);
+		for (const Book::BookMove& move : book.GetMoves(board))
+			std::cout << Pgn::MoveToSan(board, move.move) << " " << move.weight << std::endl;
+		return 0;
+	}
+
+	// book play <book> [--plies=<n>] [--depth=<n>]: the engine plays itself from the start, the book moves without a search
+	if (args.size() > 2 and args[0] == "book" and args[1] == "play") {
+		Book::Reader book(args[2]);
+		int plies = 20;
+		int depth = 6;
+		for (size_t i = 3; i < args.size(); i++)
+			if (args[i].starts_with("--plies="))
+				plies = std::stoi(args[i].substr(8));
+			else if (args[i].starts_with("--depth="))
+				depth = std::stoi(args[i].substr(8));
+		Chess chess;
+		Engine engine(chess);
+		engine.SetBook(&book);
+		engine.SetVerbose(false);
+		engine.SetDepth(depth);
+		for (int ply = 0; ply < plies and not chess.IsGameOver(); ply++) {
+			bool inBook = not book.GetMoves(chess.GetBoard()).empty();
+			Move move = engine.GetBestMove().move;
+			std::cout << Pgn::MoveToSan(chess.GetBoard(), move) << "\t";
+			if (inBook)
+				std::cout << "book" << std::endl;
+			else
+				std::cout << "searched " << engine.GetLastStats().nodes << " nodes" << std::endl;
+			engine.ApplyMove(move);
+		}
+		std::cout << chess.GetPGN() << std::endl;
+		return 0;
+	}
+
+	// daemon <socket path> [--hash=<MB>]: analyses the positions sent to the unix socket until SIGINT or SIGTERM
+	if (args.size() > 1 and args[0] == "daemon") {
+		size_t hashMegabytes = 64;
+		for (size_t i = 2; i < args.size(); i++)
+			if (args[i].starts_with("--hash="))
+				hashMegabytes = std::stoul(args[i].substr(7));
+		Daemon daemon(args[1], hashMegabytes);
+		daemon.Run();
+		return 0;
+	}
+
+	// annotate <pgn> <output> [--depth=<n>] [--movetime=<ms>] [--hash=<MB>] [--threads=<n>]:
+	// searches every position of every game, one json line per position to the output
+	if (args.size() > 2 and args[0] == "annotate") {
+		Annotate::Options options;
+		for (size_t i = 3; i < args.size(); i++)
+			if (args[i].starts_with("--depth="))
+				options.depth = std::stoi(args[i].substr(8));
+			else if (args[i].starts_with("--movetime="))
+				options.moveTimeMs = std::stoi(args[i].substr(11));
+			else if (args[i].starts_with("--hash="))
+				options.hashMegabytes = std::stoul(args[i].substr(7));
+			else if (args[i].starts_with("--threads="))
+				options.threads = std::stoul(args[i].substr(10));
+		std::ofstream out(args[2]);
+		Annotate::Stats stats = Annotate::Run(args[1], out, options);
+		double seconds = std::max(stats.timeMs, 1e-3) / 1000;
+		std::cout << stats.games << " games (" << stats.errors << " skipped) read in " << stats.readMs << "[ms], " << stats.positions <<
+				  " positions searched in " << stats.timeMs << "[ms] | " << stats.positions / seconds << " positions/s, " <<
+				  (uint64_t)(stats.nodes / seconds) << " nodes/s" << std::endl;
+		return 0;
+	}
+
+	// epd <suite> [--movetime=<ms>] [--nodes=<n>] [--hash=<MB>] [--threads=<n>]: searches every position of the suite
+	// and reports which ones were solved, and how long it took until the right move was found and stayed the best
+	if (args.size() > 1 and args[0] == "epd") {
+		Epd::Options options;
+		for (size_t i = 2; i < args.size(); i++)
+			if (args[i].starts_with("--movetime="))
+				options.moveTimeMs = std::stoi(args[i].substr(11));
+			else if (args[i].starts_with("--nodes="))
+				options.nodes = std::stoull(args[i].substr(8));
+			else if (args[i].starts_with("--hash="))
+				options.hashMegabytes = std::stoul(args[i].substr(7));
+			else if (args[i].starts_with("--threads="))
+				options.threads = std::stoul(args[i].substr(10));
+		Epd::Report report = Epd::Run(args[1], options);
+		for (const Epd::Result& result : report.results) {
+			std::cout << result.id << ":\t" << Move2Chess(result.move) << (result.solved ? "\tsolved" : "\tfailed");
+			if (result.solved)
+				std::cout << " at depth " << result.solutionDepth << " in " << result.solutionMs << "[ms], " << result.solutionNodes << " nodes";
+			std::cout << " | searched " << result.timeMs << "[ms], " << result.nodes << " nodes" << std::endl;
+		}
+		std::cout << "Solved " << report.solved << "/" << report.results.size() << " (" << report.skipped << " lines skipped) in " <<
+				  report.timeMs << "[ms] | to the solution on average: " << report.averageSolutionMs << "[ms], " <<
+				  (uint64_t)report.averageSolutionNodes << " nodes" << std::endl;
+		return 0;
+	}
+
+	// mate <moves> <fen>: looks for a forced mate of the side to move in at most that many moves
+	if (args.size() > 2 and args[0] == "mate") {
+		Board board(args[2]);
+		MateSolver solver;
+		MateResult result = solver.FindMate(board, std::stoi(args[1]));
+		if (result.mateIn)
+			std::cout << "mate in " << result.mateIn.value() << ": " << Engine::LineToString(result.line) << std::endl;
+		else
+			std::cout << "no mate in " << args[1] << std::endl;
+		std::cout << result.nodes << " nodes in " << result.timeMs << "[ms], proof size " << result.proofSize << std::endl;
+		return 0;
+	}
 
+	if (args.size() > 1 and args[0] == "bench" and args[1] == "eval") {
+		Benchmark::RunEvaluation(args.size() > 2 ? std::stoi(args[2]) : 10000000);
+		return 0;
+	}
 
+	// bench [depth] [--perf] [--profile] [--stats=<file|unix:path|tcp:host:port>]
+	//       [--movetime=<ms>] [--hash=<MB>] [--pin] [--multipv=<n>] [--no-null-move] [--no-lmr] [--no-reverse-futility] [--no-futility] [--no-razoring]
+	//       [--no-see-pruning] [--mate=<moves>] [--bitbases=<cache file>] [--hash-file=<file>] [--shared-hash] [--think] [--trace=<file>]
+	// --think searches every position in the background on all the threads of the engine, for the move time or a second
+	// --mate=<moves> runs the mate solver next to every search, it is off by default as it needs a core of its own
+	// --trace=<file> records every profiled scope of the run and writes them for chrome://tracing or perfetto,
+	// the scopes are only compiled in with CHESS_PROFILE
+	if (not args.empty() and args[0] == "bench") {
+		int depth = 4;
+		std::string statsTarget;
+		SearchOptions options;
+		int moveTimeMs = 0;
+		size_t hashMegabytes = 0;
+		std::string hashFile;
+		bool sharedHash = false;
+		bool think = false;
+		std::string traceFile;
+		for (size_t i = 1; i < args.size(); i++) {
+			if (args[i].starts_with("--movetime="))
+				moveTimeMs = std::stoi(args[i].substr(11));
+			else if (args[i].starts_with("--hash="))
+				hashMegabytes = std::stoul(args[i].substr(7));
+			else if (args[i].starts_with("--hash-file="))
+				hashFile = args[i].substr(12);
+			else if (args[i] == "--shared-hash")
+				sharedHash = true;
+			else if (args[i] == "--think")
+				think = true;
+			else if (args[i] == "--pin")
+				Memory::SetPinThreads(true);
+			else if (args[i].starts_with("--multipv="))
+				options.multiPV = std::stoi(args[i].substr(10));
+			else if (args[i] == "--no-null-move")
+				options.nullMove = false;
+			else if (args[i] == "--no-lmr")
+				options.lateMoveReductions = false;
+			else if (args[i] == "--no-reverse-futility")
+				options.reverseFutility = false;
+			else if (args[i] == "--no-futility")
+				options.futility = false;
+			else if (args[i] == "--no-razoring")
+				options.razoring = false;
+			else if (args[i] == "--no-see-pruning")
+				options.seePruning = false;
+			else if (args[i].starts_with("--bitbases="))
+				Bitbases::SetCachePath(args[i].substr(11));
+			else if (args[i].starts_with("--mate="))
+				options.mateSearchMoves = std::stoi(args[i].substr(7));
+			else if (args[i] == "--perf")
+				PerfCounters::SetEnabled(true);
+			else if (args[i] == "--profile")
+				Timer::SetEnabled(true);
+			else if (args[i].starts_with("--stats="))
+				statsTarget = args[i].substr(8);
+			else if (args[i].starts_with("--trace="))
+				traceFile = args[i].substr(8);
+			else
+				depth = std::stoi(args[i]);
+		}
+		// opened before the run, so a path that can't be written doesn't cost the whole run
+		std::ofstream trace;
+		if (not traceFile.empty()) {
+			trace.open(traceFile);
+			if (trace) {
+				Timer::SetEnabled(true);
+				Timer::SetTracing(true);
+			}
+			else
+				std::cout << "Could not open " << traceFile << " for the trace" << std::endl;
+		}
+		if (think and moveTimeMs == 0)
+			moveTimeMs = 1000;
+		Benchmark::Run(depth, statsTarget, options, moveTimeMs, hashMegabytes, hashFile, sharedHash, think);
+		if (trace.is_open()) {
+			Timer::ExportChromeTrace(trace);
+			std::cout << "Trace written to " << traceFile << std::endl;
+		}
+		return 0;
+	}
 
-int main() {
 	BoardOptimized b("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 	BoardOptimized::PrintBitBoard(b.GetWhiteKnights());
 
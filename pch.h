@@ -19,6 +19,17 @@
 #include <functional>
 #include <shared_mutex>
 #include <csignal>
+#include <charconv>
+#include <bit>
 
+// compile the profiler scopes in, they can still be switched off at runtime with Timer::SetEnabled
+#ifndef PROFILE
 #define PROFILE 1
-#include "Timer.h"
\ No newline at end of file
+#endif
+#include "Timer.h"
+
+// hardware counters are opt-in, they cost a syscall per phase change when enabled
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 0
+#endif
+#include "PerfCounters.h"
\ No newline at end of file